@@ -2,11 +2,26 @@
 
 #include "states/GameState.h"
 
-Application::Application()
+Application::Application(bool headless)
     : m_stop()
-    , m_window("Runes")
+    , m_timers(m_stop)
+    , m_window()
     , m_messenger(m_stop)
 {
+    if (!headless)
+        m_window.emplace("Runes");
+
+    // Keep input responsive when other topics are saturated. Only the latest
+    // mouse position matters, so stale movements are coalesced.
+    m_messenger.set_priority<CLICK>(2);
+    m_messenger.set_priority<KEY>(2);
+    m_messenger.set_priority<MOUSE>(1);
+    m_messenger.set_priority<SCROLL>(1);
+    m_messenger.set_deadline<MOUSE>(
+        16ms,
+        Messenger<Topics>::Expiry::COALESCE
+    );
+
     m_state = std::make_unique<GameState>(this, m_stop.get_token());
 
     m_state_thread = std::jthread(
@@ -23,12 +38,96 @@ void Application::state_machine(std::stop_token stop)
     }
 }
 
+void Application::record(const std::string &path)
+{
+    m_recorder = std::make_unique<Recording::Recorder<Topics>>(
+        m_messenger,
+        path
+    );
+}
+
+void Application::replay(
+    const std::string &path,
+    Recording::Replayer<Topics>::Speed speed
+) {
+    auto replayer = std::make_shared<Recording::Replayer<Topics>>(path);
+
+    m_replay_thread = std::jthread([this, replayer, speed](){
+        replayer->replay(m_messenger, speed, m_stop.get_token());
+
+        // Without a window there is nothing else to handle.
+        if (headless()) {
+            m_messenger.wait_idle();
+            m_stop.request_stop();
+        }
+    });
+}
+
+void Application::serve(const std::string &name)
+{
+    m_shared = std::make_shared<SharedMessenger<Topics>>(name, true, m_stop);
+
+    [this]<std::size_t... Topic>(std::index_sequence<Topic...>) {
+        (m_shared->subscribe<Topic>(
+            [this](const TypeList::Get<Topics, Topic> &message) {
+                m_messenger.publish<Topic>(
+                    TypeList::Get<Topics, Topic>(message)
+                );
+            }
+        ), ...);
+    }(std::make_index_sequence<TypeList::Size<Topics>>());
+}
+
+void Application::connect(const std::string &name)
+{
+    m_shared = std::make_shared<SharedMessenger<Topics>>(name, false, m_stop);
+
+    // Observers run under the messenger's lock, so a full ring drops the
+    // message at once rather than stalling every publisher. Drops are counted
+    // in the shared messenger's statistics.
+    m_messenger.observe(
+        [shared = m_shared](
+            std::size_t topic,
+            const void *messages,
+            std::size_t count,
+            Time::Timestamp
+        ) {
+            static const constexpr auto SIZES = Recording::sizes<Topics>(
+                std::make_index_sequence<TypeList::Size<Topics>>()
+            );
+
+            const char *message = (const char*)messages;
+            for (std::size_t i = 0; i < count; i++)
+                shared->try_publish(topic, message + i * SIZES[topic]);
+        }
+    );
+}
+
+void Application::report_dropped(std::ostream &out) const
+{
+    if (!m_shared)
+        return;
+
+    auto statistics = m_shared->statistics();
+    for (std::size_t topic = 0; topic < statistics.size(); topic++) {
+        if (statistics[topic].dropped != 0) {
+            out << "Shared messenger topic " << topic
+                << ": dropped " << statistics[topic].dropped << "\n";
+        }
+    }
+}
+
 void Application::main()
 {
+    if (headless()) {
+        StopCondition(m_stop.get_token()).wait();
+        return;
+    }
+
     sf::Event event;
     while (!m_stop.stop_requested())
     {
-        m_window->waitEvent(event);
+        window()->waitEvent(event);
 
         switch(event.type)
         {
@@ -66,6 +165,16 @@ void Application::main()
                 );
                 break;
             }
+            case sf::Event::MouseWheelScrolled: {
+                if (event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+                    m_messenger.publish<SCROLL>(
+                        event.mouseWheelScroll.x,
+                        event.mouseWheelScroll.y,
+                        event.mouseWheelScroll.delta
+                    );
+                }
+                break;
+            }
             default: break;
         }
     }
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <cassert>
+#include <optional>
+#include <ostream>
 #include <thread>
 
 #include "Message.h"
 #include "util/Messenger.h"
 #include "util/StopCondition.h"
 #include "util/ControlSet.h"
+#include "util/Recording.h"
+#include "util/SharedMessenger.h"
+#include "util/TimerWheel.h"
 #include "interface/Window.h"
 
 class Application;
@@ -54,8 +60,11 @@ public:
 
     /**
      * @brief Initialise the application.
+     * 
+     * @param headless If no window is created, so the game only handles the
+     * messages published to it, such as when benchmarking a replay.
      */
-    Application();
+    Application(bool headless = false);
 
     /**
      * @brief The main thread that handles input events.
@@ -69,6 +78,50 @@ public:
      */
     void state_machine(std::stop_token stop);
 
+    /**
+     * @brief Record every published message to a file until exit.
+     * @param path The path of the file to record to.
+     */
+    void record(const std::string &path);
+
+    /**
+     * @brief Replay a recording of published messages in the background.
+     * 
+     * When headless, the application exits once every replayed message has
+     * been handled.
+     * 
+     * @param path The path of the recording.
+     * @param speed How quickly to replay the messages.
+     */
+    void replay(
+        const std::string &path,
+        Recording::Replayer<Topics>::Speed speed
+    );
+
+    /**
+     * @brief Publish the messages other processes publish to a shared
+     * messenger, as if they were input to this application, until exit.
+     * 
+     * @param name The name of the shared messenger to create.
+     */
+    void serve(const std::string &name);
+
+    /**
+     * @brief Forward every message published in this application to a shared
+     * messenger served by another process.
+     * 
+     * @param name The name of the shared messenger to open.
+     */
+    void connect(const std::string &name);
+
+    /**
+     * @brief Write the number of messages of each topic dropped while
+     * forwarding to a shared messenger, if any were.
+     * 
+     * @param out The stream to write to.
+     */
+    void report_dropped(std::ostream &out) const;
+
     /**
      * @brief Get a reference to the messenger.
      */
@@ -77,10 +130,27 @@ public:
     }
 
     /**
-     * @brief Get a reference to the window.
+     * @brief Get a reference to the timers shared by the application.
+     */
+    inline TimerWheel &timers() {
+        return m_timers;
+    }
+
+    /**
+     * @brief Get a reference to the window. Only available when not
+     * headless.
      */
     inline Window &window() {
-        return m_window;
+        assert(m_window && "Headless applications have no window.");
+        return *m_window;
+    }
+
+    /**
+     * @brief Check if the application runs without a window.
+     * @return If there is no window.
+     */
+    inline bool headless() const {
+        return !m_window;
     }
 
 private:
@@ -88,8 +158,11 @@ private:
     /// Stop source for stopping the application.
     std::stop_source m_stop;
 
-    /// The window that states can draw to.
-    Window m_window;
+    /// Timers shared by the application, run on a single thread.
+    TimerWheel m_timers;
+
+    /// The window that states can draw to, if not headless.
+    std::optional<Window> m_window;
 
     /// The messenger for messages between different parts of the program.
     Messenger<Topics> m_messenger;
@@ -102,4 +175,14 @@ private:
 
     /// Handle main application events.
     ControlSet m_global_controls;
+
+    /// Records published messages when enabled.
+    std::unique_ptr<Recording::Recorder<Topics>> m_recorder;
+
+    /// Thread replaying a recording.
+    std::jthread m_replay_thread;
+
+    /// The shared messenger served or connected to, if any. Also held by the
+    /// observer forwarding to it, which lives as long as the messenger.
+    std::shared_ptr<SharedMessenger<Topics>> m_shared;
 };
@@ -9,7 +9,8 @@
 enum MessageType {
     CLICK,
     KEY,
-    MOUSE
+    MOUSE,
+    SCROLL
 };
 
 /**
@@ -59,11 +60,26 @@ struct Message<MOUSE> {
     int y;
 };
 
+/**
+ * @brief The mouse wheel scrolled over a location.
+ * 
+ * @param x The pixel x coordinate.
+ * @param y The pixel y coordinate.
+ * @param delta The distance scrolled, positive away from the user.
+ */
+template<>
+struct Message<SCROLL> {
+    int x;
+    int y;
+    float delta;
+};
+
 /**
  * @brief Topics available for messaging.
  */
 using Topics = TypeList::TypeList<
     Message<CLICK>,
     Message<KEY>,
-    Message<MOUSE>
+    Message<MOUSE>,
+    Message<SCROLL>
 >;
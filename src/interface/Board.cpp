@@ -1,24 +1,38 @@
 #include "interface/Board.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
 Board::Board(Vector2i size, Vector2d hexagon_size)
     : m_size(size)
+    , m_hexagon_size(hexagon_size)
+    , m_dirty(true)
+    , m_published(0)
+    , m_changes_mutex()
+    , m_changes()
+    , m_camera(0.0f, 0.0f, (float)size.x, (float)size.y)
+    , m_snapshot()
+    , m_cells()
+    , m_drawn()
+    , m_drawn_camera()
+    , m_shown()
+    , m_settled(true)
+    , m_redrawn(false)
+    , m_drawn_highlights(0)
+    , m_scale(1.0f)
+    , m_antialiasing(8)
     , m_texture()
     , m_grid()
     , m_view()
-    , m_hexagon()
+    , m_hexagons(sf::Triangles)
+    , m_edges(sf::Lines)
+    , m_highlighted(sf::Triangles)
 {
-    // Options for the texture storing the hexagonal grid.
-    sf::ContextSettings texture_settings;
-    texture_settings.antialiasingLevel = 8;
-
-    // Create the texture that contains the board.
-    if (!m_texture.create(size.x, size.y, texture_settings))
-        throw std::runtime_error("Failed to create runes texture.");
-
-    // Define the transformation from the texture to the window. The texture has
-    // the given size and should be drawn in the middle of the screen.
-    m_view.setSize((float)m_size.x, (float)m_size.y);
-    m_view.setCenter((float)m_size.x / 2, (float)m_size.y / 2);
+    // Define the transformation from the board to the texture. The camera
+    // initially shows the board at the same size as the texture.
+    m_view.reset(m_camera);
 
     // Define the hexagonal grid to have the same size d
     m_grid = Hexagon::Grid<Hexagon::GridType::FLAT>(
@@ -28,69 +42,447 @@ Board::Board(Vector2i size, Vector2d hexagon_size)
         size.y / 2
     );
 
-    // Create a hexagon that will be drawn.
-    m_hexagon.setPointCount(6);
+    // The corners of each hexagon, with the outline extending outwards from
+    // the fill along each corner's direction. Offsetting a corner of a regular
+    // hexagon by t / cos(30) moves its edges out by t.
     for (int i = 0; i < 6; i++) {
         auto [x, y] = m_grid.corner_offset(i);
-        m_hexagon.setPoint(i, Vector2d(x, y) * 0.95);
+        double length = std::sqrt(x * x + y * y) * 0.95;
+        double outline = length + OUTLINE_THICKNESS * 2.0 / SQRT3;
+
+        m_corners[i] = Vector2d(x, y) * 0.95;
+        m_outline[i] = Vector2d(x, y) * (0.95 * outline / length);
+    }
+}
+
+bool Board::publish(Runes &runes)
+{
+    std::shared_ptr<const Snapshot> last = m_snapshot.load();
+    bool game_changed = runes.version() != m_published;
+    bool camera_changed = !last || last->camera != m_camera;
+
+    if (last && !game_changed && !camera_changed && !m_dirty)
+        return false;
+
+    // The changes are added before the snapshot of their version is stored,
+    // so the render thread sees them once it sees the snapshot.
+    if (game_changed) {
+        const auto &history = runes.history();
+        std::scoped_lock<std::mutex> lock(m_changes_mutex);
+
+        for (std::size_t i = m_published; i < history.size(); i++) {
+            for (const auto &hexagon : Runes::changed(history[i])) {
+                auto it = runes.board().at(hexagon);
+                if (it == runes.board().end()) {
+                    m_changes[hexagon] = std::nullopt;
+                    continue;
+                }
+
+                auto &edges = m_changes[hexagon].emplace();
+                for (const auto &[neighbor, edge] : it.vertex().edges)
+                    edges.push_back(neighbor);
+            }
+        }
+
+        m_published = runes.version();
+    }
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->version = m_published;
+    snapshot->camera = m_camera;
+
+    snapshot->highlights.assign(m_highlights.begin(), m_highlights.end());
+    snapshot->highlights_version = last ? last->highlights_version : 0;
+    if (m_dirty)
+        snapshot->highlights_version++;
+
+    m_dirty = false;
+    m_snapshot.store(std::move(snapshot));
+    return true;
+}
+
+bool Board::draw()
+{
+    std::shared_ptr<const Snapshot> snapshot = m_snapshot.load();
+    if (!snapshot)
+        return false;
+
+    // The texture is created on first draw, so boards that are never drawn,
+    // such as when headless, need no graphics context.
+    if (m_texture.getSize().x == 0)
+        create_texture();
+
+    // Changes are taken after the snapshot, so include at least those of its
+    // version. Any of a later version are drawn again with its snapshot.
+    if (apply_changes())
+        m_cells.connected = connected();
+
+    sf::FloatRect camera = m_drawn
+        ? approach(m_drawn_camera, snapshot->camera)
+        : snapshot->camera;
+    m_settled = camera == snapshot->camera;
+
+    bool board_changed = m_drawn != snapshot->version || camera != m_drawn_camera;
+    bool highlights_changed = snapshot->highlights_version != m_drawn_highlights;
+    m_redrawn = board_changed;
+
+    if (board_changed) {
+        draw_board(m_cells, camera);
+        m_drawn = snapshot->version;
+        m_drawn_camera = camera;
+        m_shown.store(std::make_shared<const sf::FloatRect>(camera));
     }
+
+    if (highlights_changed)
+        draw_highlights(*snapshot);
+
+    return board_changed || highlights_changed;
 }
 
-void Board::draw(Runes &runes)
+bool Board::apply_changes()
 {
+    Changes changes;
+    {
+        std::scoped_lock<std::mutex> lock(m_changes_mutex);
+        std::swap(changes, m_changes);
+    }
+
+    for (auto &[hexagon, edges] : changes) {
+        auto cell = m_cells.hexagons.find(hexagon);
+        bool existed = cell != m_cells.hexagons.end();
+
+        if (edges) {
+            if (!existed)
+                count_cluster(hexagon, true);
+            m_cells.hexagons[hexagon] = std::move(*edges);
+        }
+        else if (existed) {
+            count_cluster(hexagon, false);
+            m_cells.hexagons.erase(cell);
+        }
+    }
+
+    return !changes.empty();
+}
+
+void Board::count_cluster(Hexagon::Hexagon<int> hexagon, bool added)
+{
+    double width = cluster_width();
+    auto [x, y] = m_grid.to_pixel(hexagon);
+    std::int64_t tile_x = (std::int64_t)std::floor(x / width);
+    std::int64_t tile_y = (std::int64_t)std::floor(y / width);
+
+    // Each level merges each four by four block of tiles of the level before.
+    for (auto &tiles : m_cells.clusters) {
+        std::int64_t key = tile_key(tile_x, tile_y);
+        if (added) {
+            tiles[key]++;
+        }
+        else if (--tiles[key] == 0) {
+            tiles.erase(key);
+        }
+
+        tile_x >>= 2;
+        tile_y >>= 2;
+    }
+}
+
+bool Board::connected() const
+{
+    if (m_cells.hexagons.empty())
+        return true;
+
+    // Search from any hexagon, which reaches every other if connected.
+    std::unordered_set<Hexagon::Hexagon<int>> visited;
+    std::vector<Hexagon::Hexagon<int>> stack = {m_cells.hexagons.begin()->first};
+    visited.insert(stack.back());
+
+    while (!stack.empty()) {
+        auto cell = m_cells.hexagons.find(stack.back());
+        stack.pop_back();
+
+        for (const auto &neighbor : cell->second) {
+            if (visited.insert(neighbor).second)
+                stack.push_back(neighbor);
+        }
+    }
+
+    return visited.size() == m_cells.hexagons.size();
+}
+
+void Board::draw_board(
+    const Cells &cells,
+    const sf::FloatRect &camera
+) {
     m_texture.clear();
 
     sf::Color colour;
-    if (runes.connected()) {
+    if (cells.connected) {
         colour = sf::Color::White;
     }
     else {
         colour = sf::Color::Red;
     }
 
-    m_hexagon.setFillColor(sf::Color::Black);
-    m_hexagon.setOutlineThickness(1);
+    // Vertex arrays keep their capacity when cleared, so rebuilding the batches
+    // does not allocate once the board has stopped growing.
+    m_hexagons.clear();
+    m_edges.clear();
+
+    // The level of detail by the size of the hexagons in the window.
+    double size = m_hexagon_size.x * m_size.x / camera.width;
+    bool detailed = size >= DETAILED_SIZE;
+
+    if (size < FLAT_SIZE) {
+        append_clusters(cells, camera, colour);
+    }
+    else {
+        // Look up the hexagons in view when there are fewer of them than on
+        // the board, otherwise the whole board is in view and drawn as it is.
+        std::vector<Hexagon::Hexagon<int>> visible = m_grid.range(
+            camera.left,
+            camera.top,
+            camera.left + camera.width,
+            camera.top + camera.height
+        );
+
+        if (visible.size() < cells.hexagons.size()) {
+            for (const auto &hexagon : visible) {
+                auto cell = cells.hexagons.find(hexagon);
+                if (cell != cells.hexagons.end())
+                    append_cell(cell->first, cell->second, colour, detailed);
+            }
+        }
+        else {
+            for (const auto &[hexagon, edges] : cells.hexagons)
+                append_cell(hexagon, edges, colour, detailed);
+        }
+    }
+
+    m_view.reset(camera);
     m_texture.setView(m_view);
+    m_texture.draw(m_hexagons);
+    m_texture.draw(m_edges);
+    m_texture.display();
+}
 
-    for (const auto &[a, vertex] : runes.board().vertices()) {
-        draw_hexagon(a, colour);
-        auto [x0, y0] = m_grid.to_pixel(a);
+void Board::append_cell(
+    Hexagon::Hexagon<int> hexagon,
+    const std::vector<Hexagon::Hexagon<int>> &edges,
+    sf::Color colour,
+    bool detailed
+) {
+    append_hexagon(m_hexagons, hexagon, colour, detailed);
+    if (!detailed)
+        return;
 
-        for (const auto &[b, edge] : vertex->edges) {
-            auto [x1, y1] = m_grid.to_pixel(b);
+    auto [x0, y0] = m_grid.to_pixel(hexagon);
+
+    for (const auto &neighbor : edges) {
+        auto [x1, y1] = m_grid.to_pixel(neighbor);
+        m_edges.append(sf::Vertex(sf::Vector2f(x0, y0)));
+        m_edges.append(sf::Vertex(sf::Vector2f(x1, y1)));
+    }
+}
 
-            sf::Vertex line[] = {
-                sf::Vertex(sf::Vector2f(x0, y0)),
-                sf::Vertex(sf::Vector2f(x1, y1))
-            };
+void Board::append_clusters(
+    const Cells &cells,
+    const sf::FloatRect &camera,
+    sf::Color colour
+) {
+    // Use the finest level whose tiles are at least a few pixels wide, so the
+    // number of tiles drawn is bounded by the size of the window.
+    double scale = m_size.x / camera.width;
+    double width = cluster_width();
+    std::size_t level = 0;
 
-            m_texture.draw(line, 2, sf::Lines);
-        }
+    while (level + 1 < cells.clusters.size() && width * scale < CLUSTER_PIXELS) {
+        width *= 4.0;
+        level++;
     }
 
-    for (auto &[hex, colour] : m_highlights)
-        draw_hexagon(hex, colour);
+    const auto &tiles = cells.clusters[level];
+
+    std::int64_t left = (std::int64_t)std::floor(camera.left / width);
+    std::int64_t top = (std::int64_t)std::floor(camera.top / width);
+    std::int64_t right = (std::int64_t)std::floor((camera.left + camera.width) / width);
+    std::int64_t bottom = (std::int64_t)std::floor((camera.top + camera.height) / width);
+
+    // Shade each tile by the fraction of it covered by hexagons.
+    double area = 1.5 * SQRT3 * m_hexagon_size.x * m_hexagon_size.y;
+    double capacity = width * width / area;
+
+    auto append = [&](std::int64_t x, std::int64_t y, std::size_t count) {
+        double coverage = std::min(count / capacity, 1.0);
+        sf::Color shade = colour;
+        shade.a = (std::uint8_t)(64 + 191 * coverage);
+
+        sf::Vector2f a(x * width, y * width);
+        sf::Vector2f b((x + 1) * width, y * width);
+        sf::Vector2f c((x + 1) * width, (y + 1) * width);
+        sf::Vector2f d(x * width, (y + 1) * width);
+
+        for (const auto &corner : {a, b, c, a, c, d})
+            m_hexagons.append(sf::Vertex(corner, shade));
+    };
+
+    // As with hexagons, look up the tiles in view when there are fewer of them
+    // than on the board.
+    if ((std::size_t)((right - left + 1) * (bottom - top + 1)) < tiles.size()) {
+        for (std::int64_t x = left; x <= right; x++) {
+            for (std::int64_t y = top; y <= bottom; y++) {
+                auto tile = tiles.find(tile_key(x, y));
+                if (tile != tiles.end())
+                    append(x, y, tile->second);
+            }
+        }
+    }
+    else {
+        for (const auto &[key, count] : tiles) {
+            std::int32_t x = (std::int32_t)(key >> 32);
+            std::int32_t y = (std::int32_t)(std::uint32_t)key;
+            if (left <= x && x <= right && top <= y && y <= bottom)
+                append(x, y, count);
+        }
+    }
 }
 
-void Board::draw_hexagon(Hexagon::Hexagon<int> hexagon, sf::Color colour)
+void Board::draw_highlights(const Snapshot &snapshot)
 {
+    m_highlighted.clear();
+    for (auto &[hex, colour] : snapshot.highlights)
+        append_hexagon(m_highlighted, hex, colour);
+
+    m_drawn_highlights = snapshot.highlights_version;
+}
+
+void Board::append_hexagon(
+    sf::VertexArray &vertices,
+    Hexagon::Hexagon<int> hexagon,
+    sf::Color colour,
+    bool outline
+) const {
     auto [x, y] = m_grid.to_pixel(hexagon);
+    sf::Vector2f centre(x, y);
 
-    m_hexagon.setPosition(x, y);
-    m_hexagon.setFillColor(colour);
-    m_hexagon.setOutlineColor(sf::Color::Black);
-    m_hexagon.setOutlineThickness(2);
+    // The fill as a fan of four triangles from the first corner.
+    for (int i = 1; i < 5; i++) {
+        vertices.append(sf::Vertex(centre + m_corners[0], colour));
+        vertices.append(sf::Vertex(centre + m_corners[i], colour));
+        vertices.append(sf::Vertex(centre + m_corners[i + 1], colour));
+    }
 
-    m_texture.setView(m_view);
-    m_texture.draw(m_hexagon);
+    if (!outline)
+        return;
+
+    // The outline as a quad of two triangles along each side.
+    for (int i = 0; i < 6; i++) {
+        int j = (i + 1) % 6;
+        sf::Vertex inner_i(centre + m_corners[i], sf::Color::Black);
+        sf::Vertex inner_j(centre + m_corners[j], sf::Color::Black);
+        sf::Vertex outer_i(centre + m_outline[i], sf::Color::Black);
+        sf::Vertex outer_j(centre + m_outline[j], sf::Color::Black);
+
+        vertices.append(inner_i);
+        vertices.append(outer_i);
+        vertices.append(outer_j);
+        vertices.append(inner_i);
+        vertices.append(outer_j);
+        vertices.append(inner_j);
+    }
 }
 
-void Board::display(sf::RenderWindow &window)
+void Board::set_quality(float scale, unsigned int antialiasing)
 {
-    m_texture.display();
+    if (scale == m_scale && antialiasing == m_antialiasing)
+        return;
+
+    m_scale = scale;
+    m_antialiasing = antialiasing;
+    create_texture();
+}
+
+void Board::create_texture()
+{
+    // Options for the texture storing the hexagonal grid.
+    sf::ContextSettings texture_settings;
+    texture_settings.antialiasingLevel = m_antialiasing;
+
+    // Create the texture that contains the board, smoothing it when stretched
+    // to fill the window.
+    unsigned int width = std::max((unsigned int)(m_size.x * m_scale), 1u);
+    unsigned int height = std::max((unsigned int)(m_size.y * m_scale), 1u);
+
+    if (!m_texture.create(width, height, texture_settings))
+        throw std::runtime_error("Failed to create runes texture.");
+
+    m_texture.setSmooth(m_scale < 1.0f);
+
+    // The new texture is empty, so the board is drawn again.
+    m_drawn = std::nullopt;
+}
+
+void Board::zoom(double factor, double x, double y)
+{
+    auto [board_x, board_y] = to_board(x, y);
+    double zoom = std::clamp(
+        m_camera.width * factor / m_size.x,
+        MIN_ZOOM,
+        MAX_ZOOM
+    );
 
+    float width = (float)(m_size.x * zoom);
+    float height = (float)(m_size.y * zoom);
+
+    m_camera = sf::FloatRect(
+        (float)(board_x - x * width / m_size.x),
+        (float)(board_y - y * height / m_size.y),
+        width,
+        height
+    );
+}
+
+sf::FloatRect Board::approach(
+    const sf::FloatRect &from,
+    const sf::FloatRect &to
+) const {
+    float pixel = to.width / m_size.x;
+    auto step = [&](float a, float b) {
+        // Far from the origin a step can be smaller than the precision of the
+        // coordinates, so would never arrive, so snap once it is that small.
+        float step = (b - a) * CAMERA_SMOOTHING;
+        float precision = (
+            std::max(std::abs(a), std::abs(b)) *
+            std::numeric_limits<float>::epsilon() * 4.0f
+        );
+
+        if (std::abs(b - a) < pixel / 2 || std::abs(step) <= precision)
+            return b;
+
+        return a + step;
+    };
+
+    return sf::FloatRect(
+        step(from.left, to.left),
+        step(from.top, to.top),
+        step(from.width, to.width),
+        step(from.height, to.height)
+    );
+}
+
+void Board::display(sf::RenderWindow &window)
+{
+    // The texture is already drawn through the camera, so fills the window
+    // once scaled to it, with the highlights then drawn through the same
+    // camera at full resolution.
     sf::Sprite sprite;
     sprite.setTexture(m_texture.getTexture());
-    window.setView(m_view);
+    sprite.setScale(1.0f / m_scale, 1.0f / m_scale);
+    window.setView(sf::View(sf::FloatRect(
+        0.0f, 0.0f, (float)m_size.x, (float)m_size.y
+    )));
     window.draw(sprite);
+
+    window.setView(m_view);
+    window.draw(m_highlighted);
 }
@@ -1,5 +1,16 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <SFML/Graphics.hpp>
 
 #include "interface/Window.h"
@@ -12,7 +23,32 @@ class Board
 public:
 
     /**
-     * @brief Create a new view of the board.
+     * @brief An immutable view of the game to draw, published by the threads
+     * changing the game so the render thread can draw it without locking them
+     * out.
+     * 
+     * The hexagons and edges of the game are not copied into each snapshot.
+     * Only the hexagons changed by each action are, into the changes the
+     * render thread applies to its own copy of the cells.
+     */
+    struct Snapshot
+    {
+        /// The version of the game.
+        std::size_t version;
+
+        /// The area of the board visible in the window.
+        sf::FloatRect camera;
+
+        /// Hexagons to highlight and their colour.
+        std::vector<std::pair<Hexagon::Hexagon<int>, sf::Color>> highlights;
+
+        /// Incremented every time the highlights change.
+        std::uint64_t highlights_version;
+    };
+
+    /**
+     * @brief Create a new view of the board. The texture it is drawn to is
+     * created when first drawn.
      * 
      * @param size The pixel width and height of the board.
      * @param hexagon_size The size of the hexagons 
@@ -32,43 +68,164 @@ public:
     }
 
     /**
-     * @brief Draw an entire board to the window.
+     * @brief Get the area of the board visible in the window.
+     * @return The visible area in board coordinates.
+     */
+    inline const sf::FloatRect &camera() const {
+        return m_camera;
+    }
+
+    /**
+     * @brief Set the area of the board visible in the window, shown once
+     * published.
      * 
-     * @param window 
+     * @param camera The visible area in board coordinates.
      */
-    void draw(Runes &runes);
+    inline void set_camera(const sf::FloatRect &camera) {
+        m_camera = camera;
+    }
 
     /**
-     * @brief Draw a single hexagon to the window.
+     * @brief Move the camera, shown once published.
+     * 
+     * @param dx The pixels to move the board right in the window.
+     * @param dy The pixels to move the board down in the window.
      */
-    void draw_hexagon(
-        Hexagon::Hexagon<int> hexagon,
-        sf::Color colour = sf::Color::White
-    );
+    inline void pan(double dx, double dy) {
+        m_camera.left -= dx * m_camera.width / m_size.x;
+        m_camera.top -= dy * m_camera.height / m_size.y;
+    }
 
     /**
-     * @brief Add highlight to a hexagon.
+     * @brief Zoom the camera about a pixel in the window, which stays over the
+     * same point on the board, shown once published.
+     * 
+     * @param factor The factor to scale the visible area by, so greater than
+     * one zooms out.
+     * @param x The x coordinate of the pixel to zoom about.
+     * @param y The y coordinate of the pixel to zoom about.
+     */
+    void zoom(double factor, double x, double y);
+
+    /**
+     * @brief Convert a pixel position in the window to board coordinates,
+     * through the camera last drawn, which is the one the window shows while
+     * the camera moves towards where it was set.
+     * 
+     * @param x The x coordinate of the pixel.
+     * @param y The y coordinate of the pixel.
+     * @return The (x, y) position on the board.
+     */
+    inline std::tuple<double, double> to_board(double x, double y) const {
+        std::shared_ptr<const sf::FloatRect> shown = m_shown.load();
+        const sf::FloatRect &camera = shown ? *shown : m_camera;
+
+        return std::make_tuple(
+            camera.left + x * camera.width / m_size.x,
+            camera.top + y * camera.height / m_size.y
+        );
+    }
+
+    /**
+     * @brief Publish a snapshot of the game, highlights and camera for
+     * drawing, if any changed since the last was published.
+     * 
+     * Called by threads changing the game while holding its lock. Only the
+     * hexagons changed by the actions since the last snapshot are copied from
+     * the game, so publishing costs as much as what changed rather than the
+     * size of the board. The clusters and connectivity are updated from them
+     * by the render thread.
+     * 
+     * @param runes The game to publish.
+     * @return If a new snapshot was published.
+     */
+    bool publish(Runes &runes);
+
+    /**
+     * @brief Update the layers of the board that changed since they were last
+     * drawn, from the latest published snapshot.
+     * 
+     * The board is drawn in two layers. The hexagons and edges are drawn to a
+     * texture that is cached until the game or camera changes, culling those
+     * outside the camera so drawing takes time proportional to the visible
+     * area rather than the size of the board. The highlights are
+     * an overlay drawn over it each time the board is displayed, so changing
+     * highlights costs as much as the highlights rather than the board.
+     * 
+     * Each layer is batched into vertex arrays drawn with a single draw call,
+     * so the number of draw calls does not grow with the size of the board.
+     * 
+     * The camera moves smoothly to the published camera over several draws.
+     * The detail drawn lessens as the camera zooms out, so the time taken is
+     * bounded at any zoom. Hexagons are drawn flat without edges once small,
+     * then as tiles of clustered hexagons once too small to see.
+     * 
+     * Only called by the render thread, which need not hold the game's lock.
+     * 
+     * @return If either layer changed, or false if the board is unchanged.
+     */
+    bool draw();
+
+    /**
+     * @brief Check if the camera has reached the published camera, or needs
+     * drawing again to move further.
+     * 
+     * @return If the camera drawn is the published camera.
+     */
+    inline bool settled() const {
+        return m_settled;
+    }
+
+    /**
+     * @brief Check if the last draw redrew the board texture, rather than only
+     * the highlights or nothing.
+     * 
+     * @return If the board texture was redrawn.
+     */
+    inline bool redrawn() const {
+        return m_redrawn;
+    }
+
+    /**
+     * @brief Add highlight to a hexagon, shown once published.
      * 
      * @param hexagon The hexagon to add highlight to.
      * @param colour The colour of the highlight.
      */
     void add_highlight(Hexagon::Hexagon<int> hexagon, sf::Color colour)
     {
-        m_highlights[hexagon] = colour;
+        auto [it, added] = m_highlights.try_emplace(hexagon, colour);
+        if (added || it->second != colour) {
+            it->second = colour;
+            m_dirty = true;
+        }
     }
 
     /**
-     * @brief Remove highlight from a hexagon.
+     * @brief Remove highlight from a hexagon, hidden once published.
      * 
      * @param hexagon The hexagon to remove highlight from.
      */
     inline void remove_highlight(Hexagon::Hexagon<int> hexagon)
     {
-        m_highlights.erase(hexagon);
+        if (m_highlights.erase(hexagon))
+            m_dirty = true;
     }
 
     /**
-     * @brief Display the board to a window.
+     * @brief Set the resolution and antialiasing the board is rendered at,
+     * recreating the board texture when they change.
+     * 
+     * Only called by the render thread.
+     * 
+     * @param scale The resolution relative to the window.
+     * @param antialiasing The level of multisample antialiasing.
+     */
+    void set_quality(float scale, unsigned int antialiasing);
+
+    /**
+     * @brief Display the board to a window, compositing the highlights over
+     * the cached board texture.
      * 
      * @param window The window to display the board to.
      */
@@ -76,21 +233,260 @@ public:
 
 private:
 
+    /// The thickness of the outline around each hexagon in pixels.
+    static const constexpr float OUTLINE_THICKNESS = 2.0f;
+
+    /// The least and greatest size of the visible area relative to the window.
+    static const constexpr double MIN_ZOOM = 0.25;
+    static const constexpr double MAX_ZOOM = 256.0;
+
+    /// The fraction of the remaining distance to the published camera the
+    /// drawn camera moves each draw.
+    static const constexpr float CAMERA_SMOOTHING = 0.3f;
+
+    /// The size in pixels of hexagons below which they are drawn without
+    /// outlines and edges.
+    static const constexpr double DETAILED_SIZE = 6.0;
+
+    /// The size in pixels of hexagons below which they are drawn as clusters.
+    static const constexpr double FLAT_SIZE = 3.0;
+
+    /// The width in hexagons of the tiles of the finest level of clustering.
+    static const constexpr double CLUSTER_HEXAGONS = 4.0;
+
+    /// The least width in pixels of a drawn cluster tile.
+    static const constexpr double CLUSTER_PIXELS = 4.0;
+
+    /// The number of levels of clustering, so the coarsest tiles are visible
+    /// at the greatest zoom for any reasonable size of hexagon.
+    static const constexpr std::size_t MAX_CLUSTER_LEVELS = 8;
+
+    /**
+     * @brief The hexagons and edges of the game, kept by the render thread up
+     * to date with the changes published to it.
+     */
+    struct Cells
+    {
+        /// If every hexagon on the board is connected.
+        bool connected = true;
+
+        /// Every hexagon on the board, and the hexagons it has an edge to.
+        std::unordered_map<
+            Hexagon::Hexagon<int>,
+            std::vector<Hexagon::Hexagon<int>>
+        > hexagons;
+
+        /// The number of hexagons in each square tile of the board, by tile,
+        /// for each level of clustering. The tiles of each level are four
+        /// times as wide as those of the level before.
+        std::array<
+            std::unordered_map<std::int64_t, std::size_t>,
+            MAX_CLUSTER_LEVELS
+        > clusters;
+    };
+
+    /// The hexagons changed in the game and their edges, or none if removed.
+    using Changes = std::unordered_map<
+        Hexagon::Hexagon<int>,
+        std::optional<std::vector<Hexagon::Hexagon<int>>>
+    >;
+
+    /**
+     * @brief Get the key of a cluster tile.
+     * 
+     * @param x The column of the tile.
+     * @param y The row of the tile.
+     * @return The key of the tile.
+     */
+    static inline std::int64_t tile_key(std::int64_t x, std::int64_t y) {
+        return (x << 32) | (std::uint32_t)y;
+    }
+
+    /**
+     * @brief Get the width of the tiles of the finest level of clustering.
+     * @return The width of the tiles in board coordinates.
+     */
+    inline double cluster_width() const {
+        return 2.0 * m_hexagon_size.x * CLUSTER_HEXAGONS;
+    }
+
+    /**
+     * @brief Move a camera part of the way towards another.
+     * 
+     * @param from The camera to move.
+     * @param to The camera to move towards.
+     * @return The moved camera, which is the target once within half a pixel
+     * or once a step is too small to move it.
+     */
+    sf::FloatRect approach(const sf::FloatRect &from, const sf::FloatRect &to) const;
+
+    /**
+     * @brief Apply the changes published since they were last applied to the
+     * cells.
+     * 
+     * @return If any hexagon changed.
+     */
+    bool apply_changes();
+
+    /**
+     * @brief Add or remove a hexagon from the count of its cluster tile at
+     * every level of clustering.
+     * 
+     * @param hexagon The hexagon added or removed.
+     * @param added If the hexagon was added, or false if removed.
+     */
+    void count_cluster(Hexagon::Hexagon<int> hexagon, bool added);
+
+    /**
+     * @brief Check if every hexagon of the cells is connected by edges.
+     * @return If the hexagons are connected.
+     */
+    bool connected() const;
+
+    /**
+     * @brief Create the board texture at the current quality, to be drawn
+     * again.
+     */
+    void create_texture();
+
+    /**
+     * @brief Draw the hexagons and edges of the game visible to the camera to
+     * the board texture.
+     * 
+     * @param cells The cells to draw.
+     * @param camera The visible area of the board.
+     */
+    void draw_board(const Cells &cells, const sf::FloatRect &camera);
+
+    /**
+     * @brief Append the triangles of a hexagon and the lines of its edges to
+     * the board batches.
+     * 
+     * @param hexagon The hexagon to append.
+     * @param edges The hexagons it has an edge to.
+     * @param colour The fill colour of the hexagon.
+     * @param detailed If the outline and edges are appended.
+     */
+    void append_cell(
+        Hexagon::Hexagon<int> hexagon,
+        const std::vector<Hexagon::Hexagon<int>> &edges,
+        sf::Color colour,
+        bool detailed
+    );
+
+    /**
+     * @brief Append the cluster tiles visible to the camera to the board
+     * batches, from the finest level whose tiles are visible on screen.
+     * 
+     * @param cells The cells to draw.
+     * @param camera The visible area of the board.
+     * @param colour The colour of a full tile.
+     */
+    void append_clusters(
+        const Cells &cells,
+        const sf::FloatRect &camera,
+        sf::Color colour
+    );
+
+    /**
+     * @brief Batch the highlights into the overlay.
+     * @param snapshot The snapshot containing the highlights.
+     */
+    void draw_highlights(const Snapshot &snapshot);
+
+    /**
+     * @brief Append the triangles of a hexagon and its outline to a batch.
+     * 
+     * @param vertices The triangles to append to.
+     * @param hexagon The hexagon to append.
+     * @param colour The fill colour of the hexagon.
+     * @param outline If the outline is appended.
+     */
+    void append_hexagon(
+        sf::VertexArray &vertices,
+        Hexagon::Hexagon<int> hexagon,
+        sf::Color colour = sf::Color::White,
+        bool outline = true
+    ) const;
+
     /// The size of the board in pixels.
     Vector2i m_size;
 
+    /// The size of the hexagons.
+    Vector2d m_hexagon_size;
+
     /// Hexagons to highlight.
     std::unordered_map<Hexagon::Hexagon<int>, sf::Color> m_highlights;
 
-    /// The texture to draw the board onto, that is then drawn to the window.
+    /// If the highlights changed since the last snapshot was published.
+    bool m_dirty;
+
+    /// The version of the game last published.
+    std::size_t m_published;
+
+    /// Guards the changes, taken by the render thread as they are published.
+    std::mutex m_changes_mutex;
+
+    /// The hexagons changed since the render thread last applied the changes.
+    Changes m_changes;
+
+    /// The area of the board visible in the window.
+    sf::FloatRect m_camera;
+
+    /// The latest published snapshot.
+    std::atomic<std::shared_ptr<const Snapshot>> m_snapshot;
+
+    /// The cells as of the changes last applied, only used by the render
+    /// thread.
+    Cells m_cells;
+
+    /// The version of the game last drawn to the board texture, if any.
+    std::optional<std::size_t> m_drawn;
+
+    /// The camera the board texture was last drawn with.
+    sf::FloatRect m_drawn_camera;
+
+    /// The camera last drawn with, published by the render thread alongside
+    /// the snapshot it drew so pixels are mapped to what the window shows.
+    std::atomic<std::shared_ptr<const sf::FloatRect>> m_shown;
+
+    /// If the camera last drawn with was the published camera.
+    bool m_settled;
+
+    /// If the last draw redrew the board texture.
+    bool m_redrawn;
+
+    /// The version of the highlights last drawn to the overlay.
+    std::uint64_t m_drawn_highlights;
+
+    /// The resolution of the board texture relative to the window.
+    float m_scale;
+
+    /// The level of antialiasing of the board texture.
+    unsigned int m_antialiasing;
+
+    /// The texture caching the hexagons and edges of the board, that is then
+    /// drawn to the window under the highlights.
     sf::RenderTexture m_texture;
 
     /// Hexagonal grid to play on.
     Hexagon::Grid<Hexagon::GridType::FLAT> m_grid;
 
-    /// View of the board.
+    /// View of the board through the camera last drawn with.
     sf::View m_view;
 
-    /// Hexagon to draw.
-    sf::ConvexShape m_hexagon;
+    /// The offset of each corner of a hexagon's fill from its centre.
+    std::array<sf::Vector2f, 6> m_corners;
+
+    /// The offset of each corner of a hexagon's outline from its centre.
+    std::array<sf::Vector2f, 6> m_outline;
+
+    /// Triangles of every hexagon on the board.
+    sf::VertexArray m_hexagons;
+
+    /// Lines of every edge between hexagons on the board.
+    sf::VertexArray m_edges;
+
+    /// Triangles of every highlighted hexagon, drawn over the board texture.
+    sf::VertexArray m_highlighted;
 };
@@ -1,11 +1,65 @@
+#include <cstdlib>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 #include "Application.h"
 #include "util/Search.h"
 
 int main(int argc, char **argv)
 {
-    Application app;
+    // Optionally record or replay the input messages.
+    //   --record <path>  Record all messages to a file.
+    //   --replay <path>  Replay messages from a file.
+    //   --fast           Replay as fast as possible.
+    //   --headless       Replay without a window, then print the messenger
+    //                    statistics and exit.
+    //   --serve <name>   Receive messages from other processes.
+    //   --connect <name> Send all messages to a serving process.
+    auto speed = Recording::Replayer<Topics>::Speed::ORIGINAL;
+    bool headless = false;
+    bool replaying = false;
+    for (int i = 1; i < argc; i++) {
+        std::string option(argv[i]);
+        if (option == "--fast")
+            speed = Recording::Replayer<Topics>::Speed::MAXIMUM;
+        else if (option == "--headless")
+            headless = true;
+        else if (option == "--replay")
+            replaying = true;
+    }
+
+    // Headless, nothing but a replay publishes messages or stops the game.
+    if (headless && !replaying) {
+        std::cerr << "--headless requires --replay <path>." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Application app(headless);
+
+    try {
+        for (int i = 1; i + 1 < argc; i++) {
+            std::string option(argv[i]);
+            if (option == "--record")
+                app.record(argv[++i]);
+            else if (option == "--replay")
+                app.replay(argv[++i], speed);
+            else if (option == "--serve")
+                app.serve(argv[++i]);
+            else if (option == "--connect")
+                app.connect(argv[++i]);
+        }
+    }
+    catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
     app.main();
+    app.report_dropped(std::cerr);
+
+    if (headless)
+        app.messenger().write_statistics(std::cout);
+
     return 0;
 }
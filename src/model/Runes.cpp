@@ -42,6 +42,34 @@ bool Runes::connected()
     return true;
 }
 
+std::vector<Hexagon::Hexagon<int>> Runes::changed(const Action &action)
+{
+    std::vector<Hexagon::Hexagon<int>> hexagons;
+
+    // Adding or removing a rune also changes the edges of its neighbours.
+    auto add = [&](Hexagon::Hexagon<int> hex) {
+        hexagons.push_back(hex);
+        for (auto &neighbor : hex.neighbors())
+            hexagons.push_back(neighbor);
+    };
+
+    switch (action.type) {
+        case PLACE_PLAYER_RUNE: {
+            add(((ActionData<PLACE_PLAYER_RUNE>*)action.data.get())->hexagon);
+            break;
+        }
+        case MOVE_PLAYER_RUNE: {
+            auto data = (ActionData<MOVE_PLAYER_RUNE>*)action.data.get();
+            add(data->from);
+            add(data->to);
+            break;
+        }
+        default: break;
+    }
+
+    return hexagons;
+}
+
 bool Runes::rune_moveable(Hexagon::Hexagon<int> hex)
 {
     return false;
@@ -166,6 +166,36 @@ public:
 
     bool connected();
 
+    /**
+     * @brief Get the version of the game, the number of successful actions,
+     * so views can tell if the game changed since they last saw it. The
+     * actions since a version are those of the history from its index.
+     * 
+     * @return The version of the game.
+     */
+    inline std::size_t version() const {
+        return m_history.size();
+    }
+
+    /**
+     * @brief Get the actions performed in the game, in order, so the actions
+     * since a version are those from its index.
+     * 
+     * @return The successful actions performed.
+     */
+    inline const std::vector<Action> &history() const {
+        return m_history;
+    }
+
+    /**
+     * @brief Get the hexagons whose rune or edges an action may have changed,
+     * so views can update just those rather than the whole board.
+     * 
+     * @param action The action performed.
+     * @return The hexagons the action may have changed, which may repeat.
+     */
+    static std::vector<Hexagon::Hexagon<int>> changed(const Action &action);
+
 private:
 
     /**
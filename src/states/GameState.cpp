@@ -1,5 +1,7 @@
 #include "states/GameState.h"
 
+#include <cmath>
+
 #include "interface/Window.h"
 #include "interface/Board.h"
 #include "interface/Button.h"
@@ -8,34 +10,73 @@
 
 GameState::GameState(Application *app, std::stop_token stop)
     : ApplicationState(app, stop)
-    , m_board(
-        Vector2i(app->window()->getSize().x, app->window()->getSize().y),
-        Vector2d(20, 20)
-    )
+    , m_screen_pixels(screen_size(app))
+    , m_board(m_screen_pixels, Vector2d(20, 20))
+    , m_redraw(stop, true)
+    , m_pacer(stop, app->timers())
+    , m_clicks(app->messenger().stream<CLICK>())
 {
-    auto size = app->window()->getSize();
-    m_screen_pixels = Vector2i(size.x, size.y);
-
-    auto window = app->window().lock();
-    window->clear(sf::Color::Black);
-    window->display();
+    if (!app->headless()) {
+        auto window = app->window().lock();
+        window->clear(sf::Color::Black);
+        window->display();
+    }
 
-    m_handle->messenger().subscribe<CLICK>(
-        [this](const Message<CLICK> &m) { handle_click(m); }
-    );
+    m_board.publish(m_runes);
 
-    m_handle->messenger().subscribe<MOUSE>(
+    m_mouse_subscription = m_handle->messenger().subscribe<MOUSE>(
         [this](const Message<MOUSE> &m) { handle_mouse(m); }
     );
+    m_scroll_subscription = m_handle->messenger().subscribe<SCROLL>(
+        [this](const Message<SCROLL> &m) { handle_scroll(m); }
+    );
+
+    // Headless, the game is only changed by its handlers and never drawn.
+    if (!app->headless())
+        m_render_thread = std::jthread(&GameState::render_thread, this);
 
-    m_render_thread = std::jthread(&GameState::render_thread, this);
+    m_play = play();
+}
+
+GameState::~GameState()
+{
+    m_handle->messenger().unsubscribe<MOUSE>(m_mouse_subscription);
+    m_handle->messenger().unsubscribe<SCROLL>(m_scroll_subscription);
+
+    // The game flow is only resumed by clicks, so is suspended once closed.
+    m_clicks.close();
+}
+
+Vector2i GameState::screen_size(Application *app)
+{
+    if (app->headless())
+        return HEADLESS_SIZE;
+
+    auto size = app->window()->getSize();
+    return Vector2i(size.x, size.y);
+}
+
+Task GameState::play()
+{
+    while (true) {
+        handle_click(co_await m_clicks.next());
+    }
 }
 
 void GameState::handle_click(const Message<CLICK> &click)
 {
     std::scoped_lock<std::mutex> lock(m_mutex);
 
-    Hexagon::Hexagon<int> hex = m_board.grid().to_hexagon(click.x, click.y);
+    // The middle button drags the board.
+    if (click.button == sf::Mouse::Middle) {
+        m_panning = click.pressed
+            ? std::optional<Vector2i>(Vector2i(click.x, click.y))
+            : std::nullopt;
+        return;
+    }
+
+    auto [x, y] = m_board.to_board(click.x, click.y);
+    Hexagon::Hexagon<int> hex = m_board.grid().to_hexagon(x, y);
 
     if (click.button == 0) {
         m_runes.perform<Runes::ActionType::PLACE_PLAYER_RUNE>(
@@ -45,6 +86,9 @@ void GameState::handle_click(const Message<CLICK> &click)
     else {
         m_runes.perform<Runes::ActionType::MOVE_PLAYER_RUNE>(0, hex, hex);
     }
+
+    if (m_board.publish(m_runes))
+        m_redraw.set(true);
 }
 
 void GameState::handle_mouse(const Message<MOUSE> &mouse)
@@ -52,30 +96,85 @@ void GameState::handle_mouse(const Message<MOUSE> &mouse)
     static Hexagon::Hexagon<int> last;
     std::scoped_lock<std::mutex> lock(m_mutex);
 
-    Hexagon::Hexagon<int> current = m_board.grid().to_hexagon(mouse.x, mouse.y);
+    if (m_panning) {
+        m_board.pan(mouse.x - m_panning->x, mouse.y - m_panning->y);
+        m_panning = Vector2i(mouse.x, mouse.y);
+    }
+
+    auto [x, y] = m_board.to_board(mouse.x, mouse.y);
+    Hexagon::Hexagon<int> current = m_board.grid().to_hexagon(x, y);
     m_board.remove_highlight(last);
     m_board.add_highlight(current, sf::Color(50, 50, 50, 100));
     last = current;
+
+    // Moving within the same hexagon leaves the board as it is.
+    if (m_board.publish(m_runes))
+        m_redraw.set(true);
 }
 
-void GameState::render_thread()
+void GameState::handle_scroll(const Message<SCROLL> &scroll)
 {
-    // ~144Hz
-    static Time::Duration delta = 7ms;
+    std::scoped_lock<std::mutex> lock(m_mutex);
+
+    // Each step of the wheel zooms by a fifth, in when scrolling away.
+    m_board.zoom(std::pow(1.2, -scroll.delta), scroll.x, scroll.y);
 
+    if (m_board.publish(m_runes))
+        m_redraw.set(true);
+}
+
+void GameState::render_thread()
+{
     while (!m_stop) {
 
+        // Sleep until there is something new to draw, then until its frame.
+        m_redraw.wait([](bool redraw) { return redraw; });
+        if (!m_pacer.wait())
+            break;
+
+        m_redraw.set(false);
+
+        // Draw the latest snapshot of the game, without locking out input
+        // handling. Skip the frame when the board is unchanged, as the window
+        // already shows the cached board texture.
+        Time::Timestamp start = Time::now();
+        if (!m_board.draw())
+            continue;
+
         {
-            std::scoped_lock<std::mutex> lock(m_mutex);
             auto window = m_handle->window().lock();
             window->clear();
-
-            m_board.draw(m_runes);
             m_board.display(*window);
+
+            Time::Timestamp present = Time::now();
             window->display();
+            Time::Timestamp end = Time::now();
+            m_pacer.presented(end - present);
+
+            // Lower the quality when frames take too much of their period,
+            // and raise it when they take little. Presenting flushes the
+            // drawing to the GPU, so counts towards the frame, unless the
+            // frame met its deadline and presenting only waited for the
+            // display to refresh. Frames only redrawing the highlights cost
+            // little at any quality, so would raise it again. The board is
+            // drawn again on the new texture.
+            Time::Duration cost = m_pacer.missed()
+                ? end - start
+                : present - start;
+
+            if (
+                m_board.redrawn() &&
+                m_quality.record(cost, m_pacer.period())
+            ) {
+                const auto &level = m_quality.level();
+                m_board.set_quality(level.scale, level.antialiasing);
+                m_redraw.set(true);
+            }
         }
 
-        m_stop.wait_until(Time::now() + delta);
+        // Keep drawing frames while the camera moves to where it was set.
+        if (!m_board.settled())
+            m_redraw.set(true);
     }
 }
 
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <optional>
+
 #include "Application.h"
 
 #include "model/Runes.h"
 #include "interface/Window.h"
 #include "interface/Board.h"
+#include "util/FramePacer.h"
+#include "util/QualityController.h"
+#include "util/Observable.h"
+#include "util/Task.h"
 
 class GameState : public ApplicationState
 {
@@ -22,12 +28,30 @@ public:
     virtual std::unique_ptr<ApplicationState> main() override;
 
     /**
-     * @brief Allows threads to join before destroying stop condition.
+     * @brief Unsubscribes from the messenger and waits for callbacks in
+     * progress, so that none run into the state or the game flow while they
+     * are destroyed.
      */
-    ~GameState() override {}; 
+    ~GameState() override;
 
 private:
 
+    /// The size of the screen assumed when headless, in pixels.
+    static inline const Vector2i HEADLESS_SIZE = Vector2i(1920, 1080);
+
+    /**
+     * @brief Get the size of the screen the game is shown on.
+     * 
+     * @param app The application showing the game.
+     * @return The size of the window, or HEADLESS_SIZE when headless.
+     */
+    static Vector2i screen_size(Application *app);
+
+    /**
+     * @brief The game flow, handling each click in turn as it arrives.
+     */
+    Task play();
+
     /**
      * @brief Handle a click.
      */
@@ -38,6 +62,11 @@ private:
      */
     void handle_mouse(const Message<MOUSE> &mouse);
 
+    /**
+     * @brief Handle scrolling, zooming the board.
+     */
+    void handle_scroll(const Message<SCROLL> &scroll);
+
     /**
      * @brief The game state thread used for rendering.
      */
@@ -55,6 +84,30 @@ private:
     /// The of the game.
     Board m_board;
 
+    /// The last mouse position while dragging the board, if dragging.
+    std::optional<Vector2i> m_panning;
+
+    /// Raised when the game changes and needs to be rendered again.
+    Flag m_redraw;
+
+    /// Paces rendered frames to the display.
+    FramePacer m_pacer;
+
+    /// Chooses the quality to render the board at.
+    QualityController m_quality;
+
     /// The view of the thread.
     std::jthread m_render_thread;
+
+    /// Subscription to mouse movement.
+    std::size_t m_mouse_subscription;
+
+    /// Subscription to scrolling.
+    std::size_t m_scroll_subscription;
+
+    /// Clicks awaited by the game flow.
+    Messenger<Topics>::Stream<CLICK> m_clicks;
+
+    /// The coroutine running the game flow.
+    Task m_play;
 };
@@ -0,0 +1,197 @@
+#include "util/Archetype.h"
+
+ArchetypeStorage::ArchetypeStorage()
+    : m_columns()
+    , m_next_component(0)
+{}
+
+ArchetypeStorage::~ArchetypeStorage()
+{
+    for (Archetype *archetype : m_order) {
+        for (Component component : archetype->components) {
+            const Column &column = m_columns[component];
+            for (std::size_t row = 0; row < archetype->size; row++) {
+                column.destroy(address(
+                    *archetype,
+                    archetype->offsets[component],
+                    column.size,
+                    row
+                ));
+            }
+        }
+    }
+}
+
+void ArchetypeStorage::create(Entity entity)
+{
+    std::uint32_t index = entity_index(entity);
+    if (index >= m_locations.size())
+        m_locations.resize(index + 1);
+
+    assert(!m_locations[index].archetype && "Entity index already stored.");
+
+    Archetype &empty = archetype(Signature());
+    m_locations[index] = Location{&empty, push_row(empty, entity)};
+}
+
+void ArchetypeStorage::destroy(Entity entity)
+{
+    Location &at = location(entity);
+
+    for (Component component : at.archetype->components) {
+        const Column &column = m_columns[component];
+        column.destroy(address(
+            *at.archetype,
+            at.archetype->offsets[component],
+            column.size,
+            at.row
+        ));
+    }
+
+    remove_row(*at.archetype, at.row);
+    at = Location();
+}
+
+bool ArchetypeStorage::stored(Entity entity) const
+{
+    std::uint32_t index = entity_index(entity);
+    if (index >= m_locations.size() || !m_locations[index].archetype)
+        return false;
+
+    const Location &at = m_locations[index];
+    return *static_cast<const Entity*>(
+        address(*at.archetype, at.archetype->entities, sizeof(Entity), at.row)
+    ) == entity;
+}
+
+Signature ArchetypeStorage::get_signature(Entity entity) const
+{
+    assert(stored(entity) && "Entity not stored.");
+    return m_locations[entity_index(entity)].archetype->signature;
+}
+
+ArchetypeStorage::Archetype &ArchetypeStorage::archetype(Signature signature)
+{
+    auto found = m_archetypes.find(signature);
+    if (found != m_archetypes.end())
+        return *found->second;
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->signature = signature;
+    archetype->offsets.fill(0);
+    archetype->edges.fill(nullptr);
+    archetype->size = 0;
+
+    std::size_t row_size = sizeof(Entity);
+    for (Component component = 0; component < MAX_COMPONENTS; component++) {
+        if (signature.test(component)) {
+            archetype->components.push_back(component);
+            row_size += m_columns[component].size;
+        }
+    }
+
+    // Lay out the columns for as many rows as fit, shrinking until the padding
+    // aligning each column fits too.
+    std::size_t capacity = std::max<std::size_t>(CHUNK_SIZE / row_size, 1);
+    std::size_t end;
+    archetype->entities = 0;
+
+    while (true) {
+        end = capacity * sizeof(Entity);
+
+        for (Component component : archetype->components) {
+            const Column &column = m_columns[component];
+            end = (end + column.align - 1) / column.align * column.align;
+            archetype->offsets[component] = end;
+            end += capacity * column.size;
+        }
+
+        if (end <= CHUNK_SIZE || capacity == 1)
+            break;
+
+        capacity--;
+    }
+
+    assert(
+        end <= CHUNK_SIZE &&
+        "Components of an archetype are too large for a chunk."
+    );
+    archetype->capacity = capacity;
+
+    m_order.push_back(archetype.get());
+    return *m_archetypes.emplace(signature, std::move(archetype)).first->second;
+}
+
+ArchetypeStorage::Archetype &ArchetypeStorage::toggle(
+    Archetype &from,
+    Component component
+) {
+    if (!from.edges[component]) {
+        Archetype &to = archetype(Signature(from.signature).flip(component));
+        from.edges[component] = &to;
+        to.edges[component] = &from;
+    }
+
+    return *from.edges[component];
+}
+
+std::size_t ArchetypeStorage::move(Entity entity, Archetype &to)
+{
+    Location &at = location(entity);
+    Archetype &from = *at.archetype;
+    std::size_t row = push_row(to, entity);
+
+    for (Component component : from.components) {
+        const Column &column = m_columns[component];
+        void *source = address(from, from.offsets[component], column.size, at.row);
+
+        if (to.signature.test(component))
+            column.relocate(address(to, to.offsets[component], column.size, row), source);
+        else
+            column.destroy(source);
+    }
+
+    remove_row(from, at.row);
+    at = Location{&to, row};
+    return row;
+}
+
+std::size_t ArchetypeStorage::push_row(Archetype &archetype, Entity entity)
+{
+    if (archetype.size == archetype.chunks.size() * archetype.capacity)
+        archetype.chunks.push_back(std::make_unique<Chunk>());
+
+    std::size_t row = archetype.size++;
+    *static_cast<Entity*>(
+        address(archetype, archetype.entities, sizeof(Entity), row)
+    ) = entity;
+
+    return row;
+}
+
+void ArchetypeStorage::remove_row(Archetype &archetype, std::size_t row)
+{
+    std::size_t last = archetype.size - 1;
+
+    if (row != last) {
+        for (Component component : archetype.components) {
+            const Column &column = m_columns[component];
+            column.relocate(
+                address(archetype, archetype.offsets[component], column.size, row),
+                address(archetype, archetype.offsets[component], column.size, last)
+            );
+        }
+
+        Entity moved = *static_cast<Entity*>(
+            address(archetype, archetype.entities, sizeof(Entity), last)
+        );
+        *static_cast<Entity*>(
+            address(archetype, archetype.entities, sizeof(Entity), row)
+        ) = moved;
+        m_locations[entity_index(moved)].row = row;
+    }
+
+    // Release the last chunk once empty, so every chunk holds a row.
+    if (--archetype.size == (archetype.chunks.size() - 1) * archetype.capacity)
+        archetype.chunks.pop_back();
+}
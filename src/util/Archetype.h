@@ -0,0 +1,416 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "util/Component.h"
+
+/**
+ * @brief Stores the components of entities grouped by archetype, the set of
+ * component types an entity has, for fast iteration over entities with
+ * several components.
+ *
+ * Each archetype stores its entities in fixed size chunks of memory, with
+ * each component type in its own contiguous column within the chunk, so
+ * iterating over entities with a set of components walks contiguous arrays of
+ * each component with no per entity checks. Adding or removing a component
+ * moves an entity's components to the chunk of its new archetype, so is more
+ * expensive than with a ComponentArray.
+ *
+ * It is an alternative to the ComponentManager for the same entities, so
+ * commands recorded in a CommandBuffer can be applied to either.
+ */
+class ArchetypeStorage
+{
+public:
+
+    /// The size in bytes of each chunk of an archetype.
+    static const constexpr std::size_t CHUNK_SIZE = 16 * 1024;
+
+    ArchetypeStorage();
+
+    ~ArchetypeStorage();
+
+    ArchetypeStorage(const ArchetypeStorage &other) = delete;
+    ArchetypeStorage &operator=(const ArchetypeStorage &other) = delete;
+
+    /**
+     * @brief Register a new component that an entity can own.
+     * @tparam ComponentType The type of the component.
+     */
+    template<typename ComponentType>
+    void register_component();
+
+    /**
+     * @brief Get the type identifier of a component.
+     *
+     * @tparam ComponentType The type of component.
+     * @return The type identifier of the component.
+     */
+    template<typename ComponentType>
+    inline Component type() const {
+        auto type = m_component_types.find(std::type_index(typeid(ComponentType)));
+        assert(type != m_component_types.end() && "Component not registered.");
+        return type->second;
+    }
+
+    /**
+     * @brief Add an entity without any components.
+     * @param entity The entity to add.
+     */
+    void create(Entity entity);
+
+    /**
+     * @brief Remove an entity and destroy its components.
+     * @param entity The entity to remove.
+     */
+    void destroy(Entity entity);
+
+    /**
+     * @brief Add a component to an entity, moving it to its new archetype.
+     *
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to add the component to.
+     * @param component The instance of the component.
+     */
+    template<typename ComponentType>
+    void add(Entity entity, ComponentType component);
+
+    /**
+     * @brief Remove a component from an entity, moving it to its new
+     * archetype.
+     *
+     * @tparam ComponentType The type of component to remove from the entity.
+     * @param entity The entity to remove the component from.
+     */
+    template<typename ComponentType>
+    void remove(Entity entity);
+
+    /**
+     * @brief Get the component data for an entity.
+     *
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to get the component from.
+     * @return A reference to the component data.
+     */
+    template<typename ComponentType>
+    ComponentType &get(Entity entity);
+
+    /**
+     * @brief Check if an entity is stored, rather than a stale entity with the
+     * same index.
+     *
+     * @param entity The entity to check.
+     * @return If the entity is stored.
+     */
+    bool stored(Entity entity) const;
+
+    /**
+     * @brief Get the signature of an entity.
+     *
+     * @param entity The identifier of the entity to get.
+     * @returns The component signature of the entity.
+     */
+    Signature get_signature(Entity entity) const;
+
+    /**
+     * @brief Call a function for every entity with a set of components.
+     *
+     * @tparam ComponentTypes The types of component the entities must have.
+     * @param function A function given each entity and a reference to each of
+     * its components.
+     */
+    template<typename... ComponentTypes, typename Function>
+    void each(Function &&function);
+
+    /**
+     * @brief Get the number of archetypes that have been used.
+     * @return The number of archetypes.
+     */
+    inline std::size_t archetypes() const {
+        return m_archetypes.size();
+    }
+
+private:
+
+    /**
+     * @brief How to handle the memory of a type of component.
+     */
+    struct Column
+    {
+        /// The size of the component.
+        std::size_t size;
+
+        /// The alignment of the component.
+        std::size_t align;
+
+        /// Move construct a component to uninitialised memory and destroy the
+        /// original.
+        void (*relocate)(void *to, void *from);
+
+        /// Destroy a component.
+        void (*destroy)(void *component);
+    };
+
+    /**
+     * @brief A block of memory storing a column of each component.
+     */
+    struct Chunk
+    {
+        /// The memory of the chunk, aligned to a cache line.
+        alignas(64) std::byte data[CHUNK_SIZE];
+    };
+
+    /**
+     * @brief The storage of entities with the same signature.
+     */
+    struct Archetype
+    {
+        /// The components of each entity.
+        Signature signature;
+
+        /// The type of each column, ascending.
+        std::vector<Component> components;
+
+        /// The offset in each chunk of the entity column.
+        std::size_t entities;
+
+        /// The offset in each chunk of each component column, by component.
+        std::array<std::size_t, MAX_COMPONENTS> offsets;
+
+        /// The number of entities each chunk stores.
+        std::size_t capacity;
+
+        /// The number of entities stored.
+        std::size_t size;
+
+        /// The chunks storing the entities.
+        std::vector<std::unique_ptr<Chunk>> chunks;
+
+        /// The archetypes with each component added or removed, if known.
+        std::array<Archetype*, MAX_COMPONENTS> edges;
+    };
+
+    /**
+     * @brief Where an entity is stored.
+     */
+    struct Location
+    {
+        /// The archetype storing the entity, or nullptr if not stored.
+        Archetype *archetype = nullptr;
+
+        /// The row of the entity in the archetype.
+        std::size_t row = 0;
+    };
+
+    /**
+     * @brief Get the archetype of a signature, creating it if needed.
+     *
+     * @param signature The signature of the archetype.
+     * @return The archetype.
+     */
+    Archetype &archetype(Signature signature);
+
+    /**
+     * @brief Get the archetype with a component toggled.
+     *
+     * @param from The archetype to change.
+     * @param component The component to add or remove.
+     * @return The archetype with the component toggled.
+     */
+    Archetype &toggle(Archetype &from, Component component);
+
+    /**
+     * @brief Move an entity to another archetype, relocating the components
+     * they share and destroying those the new archetype lacks.
+     *
+     * @param entity The entity to move.
+     * @param to The archetype to move the entity to.
+     * @return The row of the entity in its new archetype.
+     */
+    std::size_t move(Entity entity, Archetype &to);
+
+    /**
+     * @brief Add a row to an archetype, allocating a chunk if needed.
+     *
+     * @param archetype The archetype to add to.
+     * @param entity The entity of the row.
+     * @return The new row, whose components are uninitialised.
+     */
+    std::size_t push_row(Archetype &archetype, Entity entity);
+
+    /**
+     * @brief Fill the row of a removed entity with the last row. The row's
+     * components must already have been relocated or destroyed.
+     *
+     * @param archetype The archetype to remove from.
+     * @param row The row to remove.
+     */
+    void remove_row(Archetype &archetype, std::size_t row);
+
+    /**
+     * @brief Get the address of a column entry.
+     *
+     * @param archetype The archetype containing the column.
+     * @param offset The offset of the column in each chunk.
+     * @param size The size of each entry in the column.
+     * @param row The row of the entry.
+     * @return The address of the entry.
+     */
+    static inline void *address(
+        const Archetype &archetype,
+        std::size_t offset,
+        std::size_t size,
+        std::size_t row
+    ) {
+        return (
+            archetype.chunks[row / archetype.capacity]->data +
+            offset +
+            (row % archetype.capacity) * size
+        );
+    }
+
+    /**
+     * @brief Get the location of an entity.
+     *
+     * @param entity The entity.
+     * @return The location of the entity.
+     */
+    inline Location &location(Entity entity) {
+        assert(stored(entity) && "Entity not stored.");
+        return m_locations[entity_index(entity)];
+    }
+
+    /// Types to their allocated component type.
+    std::unordered_map<std::type_index, Component> m_component_types;
+
+    /// How to handle each type of component.
+    std::array<Column, MAX_COMPONENTS> m_columns;
+
+    /// The next component type identifier.
+    std::size_t m_next_component;
+
+    /// Every archetype by its signature.
+    std::unordered_map<Signature, std::unique_ptr<Archetype>> m_archetypes;
+
+    /// Every archetype, in order of creation, for iterating.
+    std::vector<Archetype*> m_order;
+
+    /// The location of every entity, by entity index.
+    std::vector<Location> m_locations;
+};
+
+template<typename ComponentType>
+void ArchetypeStorage::register_component()
+{
+    std::type_index index = std::type_index(typeid(ComponentType));
+    assert(m_component_types.find(index) == m_component_types.end());
+    assert(m_next_component < MAX_COMPONENTS && "Too many components.");
+    assert(alignof(ComponentType) <= alignof(Chunk) && "Component over aligned.");
+
+    m_component_types.emplace(index, m_next_component);
+    m_columns[m_next_component] = Column{
+        sizeof(ComponentType),
+        alignof(ComponentType),
+        [](void *to, void *from) {
+            ComponentType *component = static_cast<ComponentType*>(from);
+            new (to) ComponentType(std::move(*component));
+            component->~ComponentType();
+        },
+        [](void *component) {
+            static_cast<ComponentType*>(component)->~ComponentType();
+        }
+    };
+    ++m_next_component;
+}
+
+template<typename ComponentType>
+void ArchetypeStorage::add(Entity entity, ComponentType component)
+{
+    Component type = this->type<ComponentType>();
+    Location &from = location(entity);
+    assert(!from.archetype->signature.test(type) && "Component already added.");
+
+    Archetype &to = toggle(*from.archetype, type);
+    std::size_t row = move(entity, to);
+
+    new (address(to, to.offsets[type], sizeof(ComponentType), row))
+        ComponentType(std::move(component));
+}
+
+template<typename ComponentType>
+void ArchetypeStorage::remove(Entity entity)
+{
+    Component type = this->type<ComponentType>();
+    Location &from = location(entity);
+    assert(from.archetype->signature.test(type) && "Removing non-existent component.");
+
+    move(entity, toggle(*from.archetype, type));
+}
+
+template<typename ComponentType>
+ComponentType &ArchetypeStorage::get(Entity entity)
+{
+    Component type = this->type<ComponentType>();
+    Location &at = location(entity);
+    assert(at.archetype->signature.test(type) && "Retrieving non-existent component.");
+
+    return *static_cast<ComponentType*>(
+        address(
+            *at.archetype,
+            at.archetype->offsets[type],
+            sizeof(ComponentType),
+            at.row
+        )
+    );
+}
+
+template<typename... ComponentTypes, typename Function>
+void ArchetypeStorage::each(Function &&function)
+{
+    static const constexpr std::size_t COUNT = sizeof...(ComponentTypes);
+
+    std::array<Component, COUNT> types = {type<ComponentTypes>()...};
+    Signature required;
+    for (Component type : types)
+        required.set(type);
+
+    auto iterate = [&]<std::size_t... Index>(
+        Archetype &archetype,
+        std::index_sequence<Index...>
+    ) {
+        std::array<std::size_t, COUNT> offsets = {
+            archetype.offsets[types[Index]]...
+        };
+
+        for (std::size_t chunk = 0; chunk < archetype.chunks.size(); chunk++) {
+            std::byte *data = archetype.chunks[chunk]->data;
+            std::size_t rows = std::min(
+                archetype.capacity,
+                archetype.size - chunk * archetype.capacity
+            );
+
+            Entity *entities = reinterpret_cast<Entity*>(data + archetype.entities);
+            std::tuple<ComponentTypes*...> columns = {
+                std::launder(reinterpret_cast<ComponentTypes*>(data + offsets[Index]))...
+            };
+
+            for (std::size_t row = 0; row < rows; row++)
+                function(entities[row], std::get<Index>(columns)[row]...);
+        }
+    };
+
+    for (Archetype *archetype : m_order) {
+        if ((archetype->signature & required) == required && archetype->size > 0)
+            iterate(*archetype, std::index_sequence_for<ComponentTypes...>());
+    }
+}
@@ -0,0 +1,221 @@
+#include "util/CommandBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+
+CommandBuffer::~CommandBuffer()
+{
+    clear();
+}
+
+Entity CommandBuffer::create_entity()
+{
+    m_commands.push_back(Command{
+        Operation::CREATE,
+        0,
+        Signature(),
+        nullptr,
+        nullptr
+    });
+
+    return make_entity(m_pending++, PENDING);
+}
+
+void CommandBuffer::destroy_entity(Entity entity)
+{
+    m_commands.push_back(Command{
+        Operation::DESTROY,
+        entity,
+        Signature(),
+        nullptr,
+        nullptr
+    });
+}
+
+void CommandBuffer::set_signature(Entity entity, Signature signature)
+{
+    m_commands.push_back(Command{
+        Operation::SET_SIGNATURE,
+        entity,
+        signature,
+        nullptr,
+        nullptr
+    });
+}
+
+void CommandBuffer::apply(
+    EntityManager &entities,
+    ComponentManager &components,
+    SystemManager *systems
+) {
+    apply_to(entities, components, systems);
+}
+
+void CommandBuffer::apply(
+    EntityManager &entities,
+    ArchetypeStorage &archetypes,
+    SystemManager *systems
+) {
+    apply_to(entities, archetypes, systems);
+}
+
+template<typename Storage>
+void CommandBuffer::apply_to(
+    EntityManager &entities,
+    Storage &storage,
+    SystemManager *systems
+) {
+    static const constexpr bool ARCHETYPES =
+        std::is_same_v<Storage, ArchetypeStorage>;
+
+    m_created.clear();
+
+    for (Command &command : m_commands) {
+        if (command.operation == Operation::CREATE) {
+            m_created.push_back(entities.create_entity());
+            if constexpr (ARCHETYPES)
+                storage.create(m_created.back());
+            continue;
+        }
+
+        Entity entity = resolve(command.entity);
+        Signature signature;
+
+        switch (command.operation) {
+            case Operation::DESTROY: {
+                if constexpr (ARCHETYPES)
+                    storage.destroy(entity);
+                else
+                    storage.entity_destroyed(entity);
+                if (systems)
+                    systems->entity_destroyed(entity);
+                entities.destroy_entity(entity);
+                continue;
+            }
+            case Operation::ADD: {
+                const auto &operations = command.operations->on<Storage>();
+                operations.add(storage, entity, command.component);
+                command.component = nullptr;
+
+                signature = entities.get_signature(entity);
+                signature.set(operations.type(storage));
+                break;
+            }
+            case Operation::REMOVE: {
+                const auto &operations = command.operations->on<Storage>();
+                operations.remove(storage, entity);
+
+                signature = entities.get_signature(entity);
+                signature.reset(operations.type(storage));
+                break;
+            }
+            case Operation::SET_SIGNATURE: {
+                signature = command.signature;
+                break;
+            }
+            default: break;
+        }
+
+        entities.set_signature(entity, signature);
+        if (systems)
+            systems->entity_signature_changed(entity, signature);
+    }
+
+    clear();
+}
+
+void CommandBuffer::clear()
+{
+    for (Command &command : m_commands) {
+        if (command.component)
+            command.operations->destroy(command.component);
+    }
+
+    m_commands.clear();
+    m_pending = 0;
+
+    // Keep one block for the next commands.
+    if (m_blocks.size() > 1)
+        m_blocks.resize(1);
+    m_used = m_blocks.empty() ? BLOCK_SIZE : 0;
+}
+
+void *CommandBuffer::allocate(std::size_t size, std::size_t align)
+{
+    if (!m_blocks.empty()) {
+        void *memory = m_blocks.back().get() + m_used;
+        std::size_t space = BLOCK_SIZE - m_used;
+
+        if (std::align(align, size, memory, space)) {
+            m_used = BLOCK_SIZE - space + size;
+            return memory;
+        }
+    }
+
+    // Components too large for a block get a block of their own.
+    std::size_t block = std::max(BLOCK_SIZE, size + align);
+    m_blocks.push_back(std::make_unique<std::byte[]>(block));
+
+    void *memory = m_blocks.back().get();
+    std::align(align, size, memory, block);
+    m_used = block == BLOCK_SIZE
+        ? (std::byte*)memory - m_blocks.back().get() + size
+        : BLOCK_SIZE;
+
+    return memory;
+}
+
+/// The identifier of the next set of command buffers.
+static std::atomic<std::uint64_t> s_next_id = 1;
+
+CommandBuffers::CommandBuffers()
+    : m_id(s_next_id++)
+{}
+
+CommandBuffer &CommandBuffers::local()
+{
+    /// The buffer last used by this thread, and the set it belongs to.
+    static thread_local std::pair<std::uint64_t, CommandBuffer*> t_cache = {0, nullptr};
+
+    if (t_cache.first == m_id)
+        return *t_cache.second;
+
+    std::scoped_lock lock(m_mutex);
+    std::thread::id thread = std::this_thread::get_id();
+
+    auto found = std::find_if(
+        m_buffers.begin(),
+        m_buffers.end(),
+        [thread](const auto &buffer) { return buffer.first == thread; }
+    );
+
+    if (found == m_buffers.end()) {
+        m_buffers.emplace_back(thread, std::make_unique<CommandBuffer>());
+        found = m_buffers.end() - 1;
+    }
+
+    t_cache = {m_id, found->second.get()};
+    return *found->second;
+}
+
+void CommandBuffers::apply(
+    EntityManager &entities,
+    ComponentManager &components,
+    SystemManager *systems
+) {
+    std::scoped_lock lock(m_mutex);
+
+    for (auto &[thread, buffer] : m_buffers)
+        buffer->apply(entities, components, systems);
+}
+
+void CommandBuffers::apply(
+    EntityManager &entities,
+    ArchetypeStorage &archetypes,
+    SystemManager *systems
+) {
+    std::scoped_lock lock(m_mutex);
+
+    for (auto &[thread, buffer] : m_buffers)
+        buffer->apply(entities, archetypes, systems);
+}
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util/Archetype.h"
+#include "util/Component.h"
+
+/**
+ * @brief Records changes to entities and their components to apply later, so
+ * systems running in parallel can request them without changing the entity
+ * and component managers while other systems iterate over them.
+ *
+ * Commands are applied in the order they were recorded, either to a
+ * ComponentManager or to an ArchetypeStorage, whichever backend stores the
+ * components. A buffer is used by one thread at a time, see CommandBuffers for
+ * a buffer per thread.
+ */
+class CommandBuffer
+{
+public:
+
+    CommandBuffer() = default;
+
+    /**
+     * @brief Destroys components of commands that were never applied.
+     */
+    ~CommandBuffer();
+
+    CommandBuffer(const CommandBuffer &other) = delete;
+    CommandBuffer &operator=(const CommandBuffer &other) = delete;
+
+    /**
+     * @brief Record creating an entity.
+     *
+     * The returned identifier is a placeholder, which may be used in later
+     * commands of this buffer and is replaced by the created entity when the
+     * commands are applied.
+     *
+     * @return A placeholder for the created entity.
+     */
+    Entity create_entity();
+
+    /**
+     * @brief Record destroying an entity and its components.
+     * @param entity The entity to destroy.
+     */
+    void destroy_entity(Entity entity);
+
+    /**
+     * @brief Record adding a component to an entity.
+     *
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to add the component to.
+     * @param component The instance of the component.
+     */
+    template<typename ComponentType>
+    void add(Entity entity, ComponentType component);
+
+    /**
+     * @brief Record removing a component from an entity.
+     *
+     * @tparam ComponentType The type of component to remove.
+     * @param entity The entity to remove the component from.
+     */
+    template<typename ComponentType>
+    void remove(Entity entity);
+
+    /**
+     * @brief Record setting the signature of an entity.
+     *
+     * @param entity The entity.
+     * @param signature The signature of the entity.
+     */
+    void set_signature(Entity entity, Signature signature);
+
+    /**
+     * @brief Apply and clear the recorded commands.
+     *
+     * Adding and removing components also updates the signature of the entity,
+     * and the systems the entity belongs to when given.
+     *
+     * @param entities The entity manager to apply to.
+     * @param components The component manager to apply to.
+     * @param systems The system manager to notify of changes, if any.
+     */
+    void apply(
+        EntityManager &entities,
+        ComponentManager &components,
+        SystemManager *systems = nullptr
+    );
+
+    /**
+     * @brief Apply and clear the recorded commands to archetype storage.
+     *
+     * Created entities are added to the storage, and signatures follow the
+     * archetype each entity ends up in. Setting a signature only changes the
+     * entity manager and systems, as the archetype is decided by the
+     * components stored.
+     *
+     * @param entities The entity manager to apply to.
+     * @param archetypes The archetype storage to apply to.
+     * @param systems The system manager to notify of changes, if any.
+     */
+    void apply(
+        EntityManager &entities,
+        ArchetypeStorage &archetypes,
+        SystemManager *systems = nullptr
+    );
+
+    /**
+     * @brief Discard the recorded commands.
+     */
+    void clear();
+
+    /**
+     * @brief Check if there are no recorded commands.
+     * @return If the buffer is empty.
+     */
+    inline bool empty() const {
+        return m_commands.empty();
+    }
+
+private:
+
+    /// The generation marking a placeholder for an entity not yet created.
+    static const constexpr std::uint32_t PENDING = UINT32_MAX;
+
+    /// The size of each block of memory storing recorded components.
+    static const constexpr std::size_t BLOCK_SIZE = 4096;
+
+    /**
+     * @brief The kind of a recorded command.
+     */
+    enum class Operation
+    {
+        CREATE,
+        DESTROY,
+        ADD,
+        REMOVE,
+        SET_SIGNATURE
+    };
+
+    /**
+     * @brief How to apply the commands of a type of component to one kind of
+     * component storage.
+     *
+     * @tparam Storage The component storage.
+     */
+    template<typename Storage>
+    struct StorageOperations
+    {
+        /// Get the type identifier of the component.
+        Component (*type)(Storage &storage);
+
+        /// Move a recorded component to an entity, destroying the original.
+        void (*add)(Storage &storage, Entity entity, void *component);
+
+        /// Remove the component from an entity.
+        void (*remove)(Storage &storage, Entity entity);
+    };
+
+    /**
+     * @brief How to apply the commands of a type of component.
+     */
+    struct ComponentOperations
+    {
+        /// Operations on a component manager.
+        StorageOperations<ComponentManager> components;
+
+        /// Operations on archetype storage.
+        StorageOperations<ArchetypeStorage> archetypes;
+
+        /// Destroy a recorded component.
+        void (*destroy)(void *component);
+
+        /**
+         * @brief Get the operations on a kind of storage.
+         * @tparam Storage The component storage.
+         */
+        template<typename Storage>
+        inline const StorageOperations<Storage> &on() const {
+            if constexpr (std::is_same_v<Storage, ArchetypeStorage>)
+                return archetypes;
+            else
+                return components;
+        }
+    };
+
+    /**
+     * @brief A recorded command.
+     */
+    struct Command
+    {
+        /// The kind of command.
+        Operation operation;
+
+        /// The entity the command changes, possibly a placeholder.
+        Entity entity;
+
+        /// The signature to set.
+        Signature signature;
+
+        /// The operations of the component type added or removed.
+        const ComponentOperations *operations;
+
+        /// The recorded component to add.
+        void *component;
+    };
+
+    /**
+     * @brief Get the operations of a type of component.
+     * @return The operations, shared by every buffer.
+     */
+    template<typename ComponentType>
+    static const ComponentOperations *operations();
+
+    /**
+     * @brief Apply and clear the recorded commands to a component storage.
+     *
+     * @tparam Storage The component storage.
+     * @param entities The entity manager to apply to.
+     * @param storage The component storage to apply to.
+     * @param systems The system manager to notify of changes, if any.
+     */
+    template<typename Storage>
+    void apply_to(
+        EntityManager &entities,
+        Storage &storage,
+        SystemManager *systems
+    );
+
+    /**
+     * @brief Allocate memory for a recorded component. The memory is not moved
+     * as more is allocated, so components need not be trivially relocatable.
+     *
+     * @param size The size of the component.
+     * @param align The alignment of the component.
+     * @return The allocated memory.
+     */
+    void *allocate(std::size_t size, std::size_t align);
+
+    /**
+     * @brief Get the entity a command refers to, replacing placeholders.
+     *
+     * @param entity The entity or placeholder.
+     * @return The entity.
+     */
+    inline Entity resolve(Entity entity) const {
+        return entity_generation(entity) == PENDING
+            ? m_created[entity_index(entity)]
+            : entity;
+    }
+
+    /// The recorded commands in order.
+    std::vector<Command> m_commands;
+
+    /// Blocks of memory storing recorded components.
+    std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+
+    /// The number of bytes used of the last block.
+    std::size_t m_used = BLOCK_SIZE;
+
+    /// The number of entities recorded to be created.
+    std::uint32_t m_pending = 0;
+
+    /// The entity created for each placeholder while applying.
+    std::vector<Entity> m_created;
+};
+
+/**
+ * @brief A command buffer for each thread recording commands, applied
+ * together at a sync point such as the end of a frame.
+ */
+class CommandBuffers
+{
+public:
+
+    CommandBuffers();
+
+    /**
+     * @brief Get the command buffer of the calling thread.
+     *
+     * Buffers are kept between frames, so looking up the buffer of a thread
+     * only takes a lock the first time, or when the thread last used another
+     * set of buffers.
+     *
+     * @return The buffer of the calling thread.
+     */
+    CommandBuffer &local();
+
+    /**
+     * @brief Apply and clear the commands of every thread, in the order each
+     * thread first used its buffer. No thread may record commands meanwhile.
+     *
+     * @param entities The entity manager to apply to.
+     * @param components The component manager to apply to.
+     * @param systems The system manager to notify of changes, if any.
+     */
+    void apply(
+        EntityManager &entities,
+        ComponentManager &components,
+        SystemManager *systems = nullptr
+    );
+
+    /**
+     * @brief Apply and clear the commands of every thread to archetype
+     * storage. No thread may record commands meanwhile.
+     *
+     * @param entities The entity manager to apply to.
+     * @param archetypes The archetype storage to apply to.
+     * @param systems The system manager to notify of changes, if any.
+     */
+    void apply(
+        EntityManager &entities,
+        ArchetypeStorage &archetypes,
+        SystemManager *systems = nullptr
+    );
+
+private:
+
+    /// Distinguishes each set of buffers, for caching each thread's lookup.
+    std::uint64_t m_id;
+
+    /// Mutex protecting the buffers.
+    std::mutex m_mutex;
+
+    /// The buffer of each thread, in the order first used.
+    std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer>>> m_buffers;
+};
+
+template<typename ComponentType>
+void CommandBuffer::add(Entity entity, ComponentType component)
+{
+    void *memory = allocate(sizeof(ComponentType), alignof(ComponentType));
+    new (memory) ComponentType(std::move(component));
+
+    m_commands.push_back(Command{
+        Operation::ADD,
+        entity,
+        Signature(),
+        operations<ComponentType>(),
+        memory
+    });
+}
+
+template<typename ComponentType>
+void CommandBuffer::remove(Entity entity)
+{
+    m_commands.push_back(Command{
+        Operation::REMOVE,
+        entity,
+        Signature(),
+        operations<ComponentType>(),
+        nullptr
+    });
+}
+
+template<typename ComponentType>
+const CommandBuffer::ComponentOperations *CommandBuffer::operations()
+{
+    static const ComponentOperations OPERATIONS = {
+        {
+            [](ComponentManager &components) {
+                return components.type<ComponentType>();
+            },
+            [](ComponentManager &components, Entity entity, void *component) {
+                ComponentType *recorded = static_cast<ComponentType*>(component);
+                components.add<ComponentType>(entity, std::move(*recorded));
+                recorded->~ComponentType();
+            },
+            [](ComponentManager &components, Entity entity) {
+                components.remove<ComponentType>(entity);
+            }
+        },
+        {
+            [](ArchetypeStorage &archetypes) {
+                return archetypes.type<ComponentType>();
+            },
+            [](ArchetypeStorage &archetypes, Entity entity, void *component) {
+                ComponentType *recorded = static_cast<ComponentType*>(component);
+                archetypes.add<ComponentType>(entity, std::move(*recorded));
+                recorded->~ComponentType();
+            },
+            [](ArchetypeStorage &archetypes, Entity entity) {
+                archetypes.remove<ComponentType>(entity);
+            }
+        },
+        [](void *component) {
+            static_cast<ComponentType*>(component)->~ComponentType();
+        }
+    };
+
+    return &OPERATIONS;
+}
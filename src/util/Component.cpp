@@ -0,0 +1,208 @@
+#include "util/Component.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+struct SystemManager::Frame
+{
+    /// Mutex protecting the ready and waiting systems.
+    std::mutex mutex;
+
+    /// Systems whose dependencies have all finished.
+    std::vector<std::size_t> ready;
+
+    /// The number of unfinished dependencies of each system.
+    std::vector<std::size_t> waiting;
+
+    /// The number of systems finished, and the number to finish.
+    std::atomic<std::size_t> done {0};
+    std::size_t total;
+
+    /// The systems to run and the systems waiting on each, owned by the
+    /// system manager. Only used while systems are left to run, before
+    /// update() returns, so never after the manager is destroyed.
+    const std::vector<std::shared_ptr<System>> *systems;
+    const std::vector<std::vector<std::size_t>> *dependents;
+
+    /// The thread pool helping to run the systems.
+    ThreadPool *pool;
+};
+
+Entity EntityManager::create_entity()
+{
+    std::uint32_t index;
+
+    if (!m_available.empty()) {
+        index = m_available.front();
+        m_available.pop();
+    }
+    else {
+        index = m_next++;
+        if (index / PAGE_SIZE >= m_pages.size())
+            m_pages.push_back(std::make_unique<Page>());
+    }
+
+    m_size++;
+    return make_entity(
+        index,
+        m_pages[index / PAGE_SIZE]->generations[index % PAGE_SIZE]
+    );
+}
+
+void EntityManager::destroy_entity(Entity entity)
+{
+    assert(alive(entity) && "Destroying an entity that is not alive.");
+
+    std::uint32_t index = entity_index(entity);
+    Page &page = *m_pages[index / PAGE_SIZE];
+
+    // Invalidate every copy of the identifier before it is reused.
+    page.signatures[index % PAGE_SIZE].reset();
+    page.generations[index % PAGE_SIZE]++;
+
+    m_available.push(index);
+    m_size--;
+}
+
+bool EntityManager::alive(Entity entity) const
+{
+    std::uint32_t index = entity_index(entity);
+    return (
+        index < m_next &&
+        m_pages[index / PAGE_SIZE]->generations[index % PAGE_SIZE] ==
+            entity_generation(entity)
+    );
+}
+
+void EntityManager::set_signature(Entity entity, Signature signature)
+{
+    assert(alive(entity) && "Setting the signature of a stale entity.");
+
+    std::uint32_t index = entity_index(entity);
+    m_pages[index / PAGE_SIZE]->signatures[index % PAGE_SIZE] = signature;
+}
+
+Signature EntityManager::get_signature(Entity entity) const
+{
+    assert(alive(entity) && "Getting the signature of a stale entity.");
+
+    std::uint32_t index = entity_index(entity);
+    return m_pages[index / PAGE_SIZE]->signatures[index % PAGE_SIZE];
+}
+
+std::vector<std::uint64_t> ComponentManager::ticks()
+{
+    std::vector<std::uint64_t> ticks(m_next_component, 0);
+    for (auto &[type, components] : m_component_arrays)
+        ticks[m_component_types[type]] = components->tick();
+
+    return ticks;
+}
+
+void ComponentManager::trim_removed(const std::vector<std::uint64_t> &until)
+{
+    // Arrays registered since the ticks were taken have nothing to trim.
+    for (auto &[type, components] : m_component_arrays) {
+        Component component = m_component_types[type];
+        if (component < until.size())
+            components->trim_removed(until[component]);
+    }
+}
+
+void SystemManager::entity_destroyed(Entity entity)
+{
+    for (auto &system : m_systems)
+        system->m_entities.erase(entity);
+}
+
+void SystemManager::entity_signature_changed(Entity entity, Signature signature)
+{
+    for (auto &system : m_systems) {
+        if ((signature & system->signature()) == system->signature())
+            system->m_entities.insert(entity);
+        else
+            system->m_entities.erase(entity);
+    }
+}
+
+void SystemManager::update()
+{
+    if (m_systems.empty())
+        return;
+
+    // Systems find removals since they last ran, so once each has run every
+    // removal before now has been seen.
+    std::vector<std::uint64_t> seen;
+    if (m_components)
+        seen = m_components->ticks();
+
+    // Shared with the helper jobs, which may start after this returns, so
+    // they only use the frame and not the manager.
+    auto frame = std::make_shared<Frame>();
+    frame->waiting = m_dependencies;
+    frame->total = m_systems.size();
+    frame->systems = &m_systems;
+    frame->dependents = &m_dependents;
+    frame->pool = &m_pool;
+    for (std::size_t i = m_systems.size(); i-- > 0;) {
+        if (m_dependencies[i] == 0)
+            frame->ready.push_back(i);
+    }
+
+    help(frame, frame->ready.size());
+    run(frame);
+
+    for (
+        std::size_t done = frame->done.load();
+        done < frame->total;
+        done = frame->done.load()
+    ) {
+        frame->done.wait(done);
+    }
+
+    if (m_components)
+        m_components->trim_removed(seen);
+}
+
+void SystemManager::run(const std::shared_ptr<Frame> &frame)
+{
+    while (true) {
+        std::size_t system;
+        {
+            std::scoped_lock lock(frame->mutex);
+            if (frame->ready.empty())
+                return;
+
+            system = frame->ready.back();
+            frame->ready.pop_back();
+        }
+
+        (*frame->systems)[system]->update();
+
+        std::size_t released = 0;
+        {
+            std::scoped_lock lock(frame->mutex);
+            for (std::size_t dependent : (*frame->dependents)[system]) {
+                if (--frame->waiting[dependent] == 0) {
+                    frame->ready.push_back(dependent);
+                    released++;
+                }
+            }
+        }
+
+        // This thread stays to run one of the released systems.
+        help(frame, released);
+
+        // The manager may be destroyed once the last system is done.
+        if (++frame->done == frame->total)
+            frame->done.notify_all();
+    }
+}
+
+void SystemManager::help(const std::shared_ptr<Frame> &frame, std::size_t jobs)
+{
+    std::size_t helpers = std::min(frame->pool->size(), jobs) - (jobs > 0);
+    for (std::size_t i = 0; i < helpers; i++)
+        frame->pool->submit([frame](std::stop_token) { run(frame); });
+}
@@ -1,13 +1,20 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <bitset>
+#include <cassert>
 #include <cstdint>
 #include <memory>
 #include <queue>
+#include <span>
 #include <unordered_map>
 #include <typeindex>
 #include <set>
+#include <vector>
+
+#include "util/ThreadPool.h"
+#include "util/TypeList.h"
 
 /**
  * @note This implementation is based on
@@ -17,13 +24,44 @@
 
 /**
  * @brief An entity is defined by its identifier.
+ *
+ * The low 32 bits are the index of the entity, which is reused after the
+ * entity is destroyed, and the high 32 bits are the generation of the index,
+ * incremented each time it is reused, so an identifier kept after its entity
+ * was destroyed can be detected as stale.
  */
 using Entity = std::uint64_t;
 
 /**
- * @brief The maximum number of entities.
+ * @brief Get the index of an entity, used to index entity storage.
+ * 
+ * @param entity The entity identifier.
+ * @return The index of the entity.
  */
-static const constexpr Entity MAX_ENTITIES = 4096;
+inline constexpr std::uint32_t entity_index(Entity entity) {
+    return (std::uint32_t)entity;
+}
+
+/**
+ * @brief Get the generation of an entity.
+ * 
+ * @param entity The entity identifier.
+ * @return The number of times the index was reused before the entity.
+ */
+inline constexpr std::uint32_t entity_generation(Entity entity) {
+    return (std::uint32_t)(entity >> 32);
+}
+
+/**
+ * @brief Create an entity identifier.
+ * 
+ * @param index The index of the entity.
+ * @param generation The generation of the index.
+ * @return The entity identifier.
+ */
+inline constexpr Entity make_entity(std::uint32_t index, std::uint32_t generation) {
+    return ((Entity)generation << 32) | index;
+}
 
 /**
  * @brief Each component has its own identifier.
@@ -46,11 +84,18 @@ using Signature = std::bitset<MAX_COMPONENTS>;
  * @brief The entity manager provides information about entity types.
  * 
  * It returns bit sets with flags set for each component an entity has,
- * contained within contiguous memory for minimal cache misses.
+ * contained within contiguous memory for minimal cache misses. Storage grows
+ * in pages as entities are created, and indices of destroyed entities are
+ * reused first, so memory is proportional to the most entities alive at once.
  */
 class EntityManager
 {
-    EntityManager();
+public:
+
+    EntityManager()
+        : m_next(0)
+        , m_size(0)
+    {}
 
     /**
      * @brief Create a new entity.
@@ -67,6 +112,14 @@ class EntityManager
      */
     void destroy_entity(Entity entity);
 
+    /**
+     * @brief Check if an entity has been created and not destroyed.
+     * 
+     * @param entity The identifier of the entity.
+     * @return If the entity is alive, or false if the identifier is stale.
+     */
+    bool alive(Entity entity) const;
+
     /**
      * @brief Set the component signature of an entity.
      * 
@@ -81,20 +134,50 @@ class EntityManager
      * @param entity The identifier of the entity to get.
      * @returns The component signature of the entity.
      */
-    Signature get_signature(Entity entity);
+    Signature get_signature(Entity entity) const;
+
+    /**
+     * @brief Get the number of living entities.
+     * @return The number of entities.
+     */
+    inline std::size_t size() const {
+        return m_size;
+    }
 
 private:
 
-    /// The queue of available entity identifiers.
-    std::queue<Entity> m_available;
+    /// The number of entities in each page.
+    static const constexpr std::size_t PAGE_SIZE = 1024;
+
+    /**
+     * @brief The storage of a page of entities.
+     */
+    struct Page
+    {
+        /// The signature of each entity.
+        std::array<Signature, PAGE_SIZE> signatures {};
 
-    /// The signatures of all registered components.
-    std::array<Signature, MAX_ENTITIES> m_signatures;
+        /// The current generation of each index.
+        std::array<std::uint32_t, PAGE_SIZE> generations {};
+    };
+
+    /// The queue of available entity indices.
+    std::queue<std::uint32_t> m_available;
+
+    /// The pages of entity storage.
+    std::vector<std::unique_ptr<Page>> m_pages;
+
+    /// The next index never used.
+    std::uint32_t m_next;
+
+    /// The number of living entities.
+    std::size_t m_size;
 };
 
 /**
- * @brief 
- * 
+ * @brief Type erased interface of a component array, so the component manager
+ * can notify every array when an entity is destroyed, and trim every array's
+ * log of removals.
  */
 class IComponentArray
 {
@@ -103,19 +186,45 @@ public:
 	virtual ~IComponentArray() = default;
 
     /**
-     * @brief Callback to check if 
+     * @brief Callback to remove the component of a destroyed entity, if it has
+     * one.
      * 
-     * @param entity 
+     * @param entity The entity that was destroyed.
+     */
+	virtual void entity_destroyed(Entity entity) = 0;
+
+    /**
+     * @brief Get the tick of the latest change to the array.
+     * @return The current tick of the array.
      */
-	virtual void EntityDestroyed(Entity entity) = 0;
+    virtual std::uint64_t tick() const = 0;
+
+    /**
+     * @brief Forget removals up to a tick, once every system has seen them.
+     * @param until The tick up to which removals are forgotten.
+     */
+    virtual void trim_removed(std::uint64_t until) = 0;
 };
 
 /**
  * @brief An array of a single type of component, that stores a component for
  * each entity if it has one.
+ *
+ * The array is a sparse set. Components are packed contiguously in a dense
+ * array alongside the entity owning each, and a sparse array indexed by entity
+ * index gives the index of its component. The sparse array is allocated in pages as
+ * entities are added, so looking up a component is two array accesses with no
+ * hashing, and memory grows with the range of entities actually used.
+ * Removing a component moves the last component into its place, so the order
+ * of components changes on removal.
+ *
+ * Each component records the tick it was last added or changed on, and each
+ * removal is logged with its tick, so systems can visit only what changed
+ * since they last ran. Changes made through get() or components() are only
+ * seen once marked with mark_changed().
  */
 template<typename ComponentType>
-class ComponentArray : public IComponentArray
+class ComponentArray final : public IComponentArray
 {
 public:
 
@@ -135,6 +244,81 @@ public:
      */
     ComponentType &get(Entity entity);
 
+    /**
+     * @brief Get the component of an entity to change it, marking it changed.
+     * 
+     * @param entity The entity to get the component of.
+     * @returns The component of the entity.
+     */
+    inline ComponentType &modify(Entity entity) {
+        mark_changed(entity);
+        return get(entity);
+    }
+
+    /**
+     * @brief Mark the component of an entity as changed, after changing it
+     * through get() or components().
+     * 
+     * @param entity The entity whose component changed.
+     */
+    void mark_changed(Entity entity);
+
+    /**
+     * @brief Check if an entity has a component.
+     * 
+     * @param entity The entity to check.
+     * @return If the entity has a component in the array.
+     */
+    bool has(Entity entity) const;
+
+    /**
+     * @brief Check if the component of an entity was added or changed since a
+     * tick.
+     * 
+     * @param entity The entity to check.
+     * @param since A tick previously returned by tick().
+     * @return If the component changed after the tick.
+     */
+    bool changed(Entity entity, std::uint64_t since) const;
+
+    /**
+     * @brief Get the tick of the latest change, which a system can keep to
+     * find the changes made after it last ran.
+     * 
+     * @return The current tick of the array.
+     */
+    inline std::uint64_t tick() const override {
+        return m_tick;
+    }
+
+    /**
+     * @brief Call a function for every component added or changed since a
+     * tick.
+     * 
+     * @param since A tick previously returned by tick(), or zero for all.
+     * @param function A function given each entity and its component.
+     */
+    template<typename Function>
+    void each_changed(std::uint64_t since, Function &&function);
+
+    /**
+     * @brief Call a function for every entity whose component was removed
+     * since a tick, and not since trimmed.
+     * 
+     * @param since A tick previously returned by tick().
+     * @param function A function given each entity.
+     */
+    template<typename Function>
+    void each_removed(std::uint64_t since, Function &&function) const;
+
+    /**
+     * @brief Forget removals up to a tick, once every system has seen them.
+     * A SystemManager given the component manager does so after each update.
+     * 
+     * @param until The tick up to which removals are forgotten.
+     */
+    void trim_removed(std::uint64_t until) override;
+
     /**
      * @brief Reset an entities data.
      * 
@@ -148,58 +332,213 @@ public:
      */
     void entity_destroyed(Entity entity) override;
 
+    /**
+     * @brief Get the number of components in the array.
+     * @return The number of entities with a component.
+     */
+    inline std::size_t size() const {
+        return m_components.size();
+    }
+
+    /**
+     * @brief Get the packed components, for iterating over every component.
+     * @return The components, in the same order as entities().
+     */
+    inline std::span<ComponentType> components() {
+        return m_components;
+    }
+
+    /**
+     * @brief Get the entity owning each packed component.
+     * @return The entities, in the same order as components().
+     */
+    inline std::span<const Entity> entities() const {
+        return m_entities;
+    }
+
 private:
 
-    /// An instance of the component for every entity. Sparse.
-    std::array<ComponentType, MAX_ENTITIES> m_components;
+    /// The number of entities indexed by each page of the sparse array.
+    static const constexpr std::size_t PAGE_SIZE = 1024;
 
-    /// Mapping from each entity to the index in the component array.
-    std::unordered_map<Entity, std::size_t> m_entity_to_index;
+    /// Index of an entity without a component.
+    static const constexpr std::size_t INVALID = SIZE_MAX;
 
-    /// Mapping of indexes to the entity they point to.
-    std::unordered_map<std::size_t, Entity> m_index_to_entity;
+    /// A page of indices into the dense arrays.
+    using Page = std::array<std::size_t, PAGE_SIZE>;
 
-    /// Total number of valid entries in the array.
-    std::size_t m_size;
+    /**
+     * @brief Get the entry of an entity in the sparse array, whose page must
+     * be allocated.
+     * 
+     * @param entity The entity.
+     * @return The index of the entity's component, or INVALID.
+     */
+    inline std::size_t &sparse(Entity entity) {
+        std::uint32_t index = entity_index(entity);
+        return (*m_sparse[index / PAGE_SIZE])[index % PAGE_SIZE];
+    }
+
+    /// Pages of the index of each entity's component, allocated when used.
+    std::vector<std::unique_ptr<Page>> m_sparse;
+
+    /// The component of each entity that has one, packed.
+    std::vector<ComponentType> m_components;
+
+    /// The entity owning each packed component.
+    std::vector<Entity> m_entities;
+
+    /// The tick each packed component was last added or changed on.
+    std::vector<std::uint64_t> m_changed;
+
+    /// Entities whose component was removed, and the tick it was removed on.
+    std::vector<std::pair<Entity, std::uint64_t>> m_removed;
+
+    /// The tick of the latest change.
+    std::uint64_t m_tick = 0;
 };
 
 template<typename ComponentType>
 void ComponentArray<ComponentType>::add(Entity entity, ComponentType component)
 {
-    std::size_t index = m_size;
-    m_entity_to_index[entity] = index;
-    m_index_to_entity[index] = entity;
-    m_components[index] = component;
-    ++m_size;
+    assert(!has(entity) && "Component added to the same entity twice.");
+
+    std::size_t page = entity_index(entity) / PAGE_SIZE;
+    if (page >= m_sparse.size())
+        m_sparse.resize(page + 1);
+
+    if (!m_sparse[page]) {
+        m_sparse[page] = std::make_unique<Page>();
+        m_sparse[page]->fill(INVALID);
+    }
+
+    // A stale generation of the entity may still have a component.
+    assert(
+        sparse(entity) == INVALID &&
+        "Component added while a stale entity has one."
+    );
+
+    sparse(entity) = m_components.size();
+    m_components.push_back(std::move(component));
+    m_entities.push_back(entity);
+    m_changed.push_back(++m_tick);
 }
 
 template<typename ComponentType>
 ComponentType &ComponentArray<ComponentType>::get(Entity entity)
 {
-    return m_components[m_entity_to_index[entity]];
+    assert(has(entity) && "Retrieving non-existent component.");
+    return m_components[sparse(entity)];
+}
+
+template<typename ComponentType>
+bool ComponentArray<ComponentType>::has(Entity entity) const
+{
+    std::size_t page = entity_index(entity) / PAGE_SIZE;
+    if (page >= m_sparse.size() || !m_sparse[page])
+        return false;
+
+    std::size_t index = (*m_sparse[page])[entity_index(entity) % PAGE_SIZE];
+    return index != INVALID && m_entities[index] == entity;
 }
 
 template<typename ComponentType>
 void ComponentArray<ComponentType>::remove(Entity entity)
 {
-    std::size_t index = m_entity_to_index[entity];
-    std::size_t last_index = m_size - 1;
-    Entity last_entity = m_index_to_entity[last_index];
+    assert(has(entity) && "Removing non-existent component.");
+
+    std::size_t &index = sparse(entity);
+    Entity last_entity = m_entities.back();
 
     // Maintain contiguous by moving last component and entity to removed.
-    m_components[index] = m_components[last_index];
-    m_entity_to_index[last_entity] = index;
-    m_index_to_entity[index] = last_entity;
+    if (last_entity != entity) {
+        m_components[index] = std::move(m_components.back());
+        m_entities[index] = last_entity;
+        m_changed[index] = m_changed.back();
+        sparse(last_entity) = index;
+    }
 
     // Remove the entity.
-    m_entity_to_index.erase(entity);
-    m_index_to_entity.erase(last_index);
+    m_components.pop_back();
+    m_entities.pop_back();
+    m_changed.pop_back();
+    index = INVALID;
+
+    m_removed.emplace_back(entity, ++m_tick);
+}
+
+template<typename ComponentType>
+void ComponentArray<ComponentType>::mark_changed(Entity entity)
+{
+    assert(has(entity) && "Changing non-existent component.");
+    m_changed[sparse(entity)] = ++m_tick;
+}
+
+template<typename ComponentType>
+bool ComponentArray<ComponentType>::changed(Entity entity, std::uint64_t since) const
+{
+    if (!has(entity))
+        return false;
+
+    std::uint32_t index = entity_index(entity);
+    return m_changed[(*m_sparse[index / PAGE_SIZE])[index % PAGE_SIZE]] > since;
+}
+
+template<typename ComponentType>
+template<typename Function>
+void ComponentArray<ComponentType>::each_changed(
+    std::uint64_t since,
+    Function &&function
+) {
+    // Nothing to scan when nothing changed.
+    if (since >= m_tick)
+        return;
+
+    for (std::size_t i = 0; i < m_changed.size(); i++) {
+        if (m_changed[i] > since)
+            function(m_entities[i], m_components[i]);
+    }
+}
+
+template<typename ComponentType>
+template<typename Function>
+void ComponentArray<ComponentType>::each_removed(
+    std::uint64_t since,
+    Function &&function
+) const {
+    // Removals are logged in tick order, so only the end needs visiting.
+    auto first = std::upper_bound(
+        m_removed.begin(),
+        m_removed.end(),
+        since,
+        [](std::uint64_t since, const auto &removed) {
+            return since < removed.second;
+        }
+    );
+
+    for (auto removed = first; removed != m_removed.end(); removed++)
+        function(removed->first);
+}
+
+template<typename ComponentType>
+void ComponentArray<ComponentType>::trim_removed(std::uint64_t until)
+{
+    auto last = std::upper_bound(
+        m_removed.begin(),
+        m_removed.end(),
+        until,
+        [](std::uint64_t until, const auto &removed) {
+            return until < removed.second;
+        }
+    );
+
+    m_removed.erase(m_removed.begin(), last);
 }
 
 template<typename ComponentType>
 void ComponentArray<ComponentType>::entity_destroyed(Entity entity)
 {
-    if (m_entity_to_index.find(entity) != m_entity_to_index.end()) {
+    if (has(entity)) {
         remove(entity);
     }
 }
@@ -247,7 +586,7 @@ public:
      */
     template<typename ComponentType>
     inline void add(Entity entity, ComponentType component) {
-        get_components<ComponentType>()->add(entity, component);
+        get_components<ComponentType>()->add(entity, std::move(component));
     }
 
     /**
@@ -270,7 +609,41 @@ public:
      */
     template<typename ComponentType>
     inline ComponentType &get(Entity entity) {
-        get_components<ComponentType>()->get(entity);
+        return get_components<ComponentType>()->get(entity);
+    }
+
+    /**
+     * @brief Get the component data for an entity to change it, marking it
+     * changed.
+     * 
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to get the component from.
+     * @return A reference to the component data.
+     */
+    template<typename ComponentType>
+    inline ComponentType &modify(Entity entity) {
+        return get_components<ComponentType>()->modify(entity);
+    }
+
+    /**
+     * @brief Get the array of a component type, to find the components that
+     * changed or were removed since a system last ran.
+     *
+     * @tparam ComponentType The type of component.
+     * @return The array of components for each entity.
+     */
+    template<typename ComponentType>
+    inline ComponentArray<ComponentType> &components() {
+        return *get_components<ComponentType>();
+    }
+
+    /**
+     * @brief Remove every component of a destroyed entity.
+     * @param entity The entity that was destroyed.
+     */
+    inline void entity_destroyed(Entity entity) {
+        for (auto &[type, components] : m_component_arrays)
+            components->entity_destroyed(entity);
     }
 
     /**
@@ -281,6 +654,20 @@ public:
         return m_next_component;
     } 
 
+    /**
+     * @brief Get the current tick of every component array.
+     * @return The tick of each array, indexed by component type identifier.
+     */
+    std::vector<std::uint64_t> ticks();
+
+    /**
+     * @brief Forget the removals of every component array up to a tick of
+     * each, once every system has seen them.
+     * 
+     * @param until The tick of each array, as returned by ticks().
+     */
+    void trim_removed(const std::vector<std::uint64_t> &until);
+
 private:
 
     /**
@@ -310,20 +697,367 @@ template<typename ComponentType>
 void ComponentManager::register_component()
 {
     std::type_index index = std::type_index(typeid(ComponentType));
-    assert(m_component_names.find(index) != m_component_arrays.end());
+    assert(m_component_types.find(index) == m_component_types.end());
 
     m_component_types.emplace(index, m_next_component);
     m_component_arrays.emplace(index, std::make_shared<ComponentArray<ComponentType>>());
     ++m_next_component;
 }
 
+/**
+ * @brief Manages a fixed set of component types known at compile time.
+ *
+ * Component types are identified by their index in the type list, and the
+ * array of each is a member of a tuple, so finding the array of a component
+ * is resolved at compile time with no hashing or casting.
+ *
+ * @tparam Components A type list of the types of each component.
+ */
+template<typename Components>
+class StaticComponentManager
+{
+public:
+
+    static_assert(
+        TypeList::Size<Components> <= MAX_COMPONENTS,
+        "Too many components for a signature."
+    );
+
+    /**
+     * @brief Get the type identifier of a component.
+     *
+     * @tparam ComponentType The type of component.
+     * @return The type identifier of the component.
+     */
+    template<typename ComponentType>
+    static constexpr Component type() {
+        return TypeList::Index<Components, ComponentType>;
+    }
+
+    /**
+     * @brief Get the signature of entities with a set of components.
+     *
+     * @tparam ComponentTypes The types of component.
+     * @return The signature with the bit of each component set.
+     */
+    template<typename... ComponentTypes>
+    static Signature signature() {
+        Signature signature;
+        (signature.set(type<ComponentTypes>()), ...);
+        return signature;
+    }
+
+    /**
+     * @brief Add a component to an entity.
+     *
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to add the component to.
+     * @param component The instance of the component.
+     */
+    template<typename ComponentType>
+    inline void add(Entity entity, ComponentType component) {
+        components<ComponentType>().add(entity, std::move(component));
+    }
+
+    /**
+     * @brief Remove a component from an entity.
+     *
+     * @tparam ComponentType The type of component to remove from the entity.
+     * @param entity The entity to remove the component from.
+     */
+    template<typename ComponentType>
+    inline void remove(Entity entity) {
+        components<ComponentType>().remove(entity);
+    }
+
+    /**
+     * @brief Get the component data for an entity.
+     *
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to get the component from.
+     * @return A reference to the component data.
+     */
+    template<typename ComponentType>
+    inline ComponentType &get(Entity entity) {
+        return components<ComponentType>().get(entity);
+    }
+
+    /**
+     * @brief Get the component data for an entity to change it, marking it
+     * changed.
+     *
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to get the component from.
+     * @return A reference to the component data.
+     */
+    template<typename ComponentType>
+    inline ComponentType &modify(Entity entity) {
+        return components<ComponentType>().modify(entity);
+    }
+
+    /**
+     * @brief Check if an entity has a component.
+     *
+     * @tparam ComponentType The type of component.
+     * @param entity The entity to check.
+     * @return If the entity has the component.
+     */
+    template<typename ComponentType>
+    inline bool has(Entity entity) const {
+        return std::get<type<ComponentType>()>(m_components).has(entity);
+    }
+
+    /**
+     * @brief Remove every component of a destroyed entity.
+     * @param entity The entity that was destroyed.
+     */
+    inline void entity_destroyed(Entity entity) {
+        std::apply(
+            [entity](auto &... arrays) { (arrays.entity_destroyed(entity), ...); },
+            m_components
+        );
+    }
+
+    /**
+     * @brief Get the array of a component type.
+     *
+     * @tparam ComponentType The type of component.
+     * @return The array of components for each entity.
+     */
+    template<typename ComponentType>
+    inline ComponentArray<ComponentType> &components() {
+        return std::get<type<ComponentType>()>(m_components);
+    }
+
+    /**
+     * @brief Get the number of component types.
+     * @return The number of component types.
+     */
+    static constexpr std::size_t size() {
+        return TypeList::Size<Components>;
+    }
+
+private:
+
+    /**
+     * @brief Meta function for the array of a component type.
+     */
+    template<typename ComponentType>
+    struct ArrayOf
+    {
+        using type = ComponentArray<ComponentType>;
+    };
+
+    /// The array of component instances of each entity for each component type.
+    TypeList::TupleOf<TypeList::Transform<Components, ArrayOf>> m_components;
+};
+
+/**
+ * @brief A system updates the entities with a set of components each frame.
+ *
+ * A system declares which components it reads and which it writes, so the
+ * system manager can run systems in parallel when they do not conflict.
+ */
 class System
 {
 public:
+
+    /**
+     * @brief Create a system.
+     *
+     * @param reads The components the system only reads.
+     * @param writes The components the system writes.
+     */
+    System(Signature reads, Signature writes)
+        : m_reads(reads)
+        , m_writes(writes)
+    {}
+
+    virtual ~System() = default;
+
+    /**
+     * @brief Update the entities of the system, once per frame.
+     */
+    virtual void update() = 0;
+
+    /**
+     * @brief Get the components the system reads.
+     * @return The signature of the components read.
+     */
+    inline Signature reads() const {
+        return m_reads;
+    }
+
+    /**
+     * @brief Get the components the system writes.
+     * @return The signature of the components written.
+     */
+    inline Signature writes() const {
+        return m_writes;
+    }
+
+    /**
+     * @brief Get the components an entity needs to be updated by the system.
+     * @return The signature of every component accessed.
+     */
+    inline Signature signature() const {
+        return m_reads | m_writes;
+    }
+
+    /**
+     * @brief Check if running alongside another system could race.
+     *
+     * @param other The other system.
+     * @return If either system writes a component the other accesses.
+     */
+    inline bool conflicts(const System &other) const {
+        return (
+            (m_writes & other.signature()).any() ||
+            (other.m_writes & signature()).any()
+        );
+    }
+
+    /// The entities with every component the system accesses.
     std::set<Entity> m_entities;
+
+private:
+
+    /// The components the system only reads.
+    Signature m_reads;
+
+    /// The components the system writes.
+    Signature m_writes;
 };
 
+/**
+ * @brief Runs every system each frame, in parallel on a thread pool where
+ * their components do not conflict.
+ *
+ * Systems that conflict run in the order they were registered. The graph of
+ * which systems must wait for which is built as systems are registered, and
+ * each frame releases systems to the pool as the systems they wait for finish.
+ */
 class SystemManager
 {
+public:
+
+    /**
+     * @brief Create a system manager.
+     * 
+     * @param pool The thread pool to run systems on.
+     * @param components The components the systems use, whose removals are
+     * forgotten once every system has run after them, if given. Must outlive
+     * the system manager.
+     */
+    SystemManager(
+        ThreadPool &pool = ThreadPool::global(),
+        ComponentManager *components = nullptr
+    )
+        : m_pool(pool)
+        , m_components(components)
+    {}
+
+    /**
+     * @brief Register a system to run each frame.
+     *
+     * @tparam SystemType The type of the system.
+     * @param args The arguments to construct the system with.
+     * @return The system.
+     */
+    template<typename SystemType, typename... Args>
+    std::shared_ptr<SystemType> register_system(Args&&... args);
+
+    /**
+     * @brief Remove a destroyed entity from every system.
+     * @param entity The entity that was destroyed.
+     */
+    void entity_destroyed(Entity entity);
+
+    /**
+     * @brief Update which systems an entity belongs to after its components
+     * change.
+     *
+     * @param entity The entity that changed.
+     * @param signature The new signature of the entity.
+     */
+    void entity_signature_changed(Entity entity, Signature signature);
+
+    /**
+     * @brief Run every system once, returning when all have finished. The
+     * calling thread runs systems too.
+     * 
+     * Every system has then seen the removals made before the update began,
+     * so those are forgotten from the component manager, if given.
+     */
+    void update();
+
+    /**
+     * @brief Get the number of registered systems.
+     * @return The number of systems.
+     */
+    inline std::size_t size() const {
+        return m_systems.size();
+    }
+
+private:
 
+    /**
+     * @brief The progress of running every system once.
+     */
+    struct Frame;
+
+    /**
+     * @brief Run ready systems of a frame until there are none, releasing the
+     * systems waiting on each.
+     *
+     * Static, as helpers may run after the manager is destroyed, when they
+     * find no systems left to run.
+     *
+     * @param frame The frame to run systems of.
+     */
+    static void run(const std::shared_ptr<Frame> &frame);
+
+    /**
+     * @brief Ask the thread pool to help run ready systems of a frame.
+     *
+     * @param frame The frame to run systems of.
+     * @param jobs The number of systems that could run in parallel.
+     */
+    static void help(const std::shared_ptr<Frame> &frame, std::size_t jobs);
+
+    /// The thread pool to run systems on.
+    ThreadPool &m_pool;
+
+    /// The components whose removals are trimmed after each update, if any.
+    ComponentManager *m_components;
+
+    /// Every system in order of registration.
+    std::vector<std::shared_ptr<System>> m_systems;
+
+    /// The systems waiting for each system to finish.
+    std::vector<std::vector<std::size_t>> m_dependents;
+
+    /// The number of systems each system waits for.
+    std::vector<std::size_t> m_dependencies;
 };
+
+template<typename SystemType, typename... Args>
+std::shared_ptr<SystemType> SystemManager::register_system(Args&&... args)
+{
+    auto system = std::make_shared<SystemType>(std::forward<Args>(args)...);
+    std::size_t index = m_systems.size();
+
+    m_dependents.emplace_back();
+    m_dependencies.push_back(0);
+
+    // Wait for every earlier system touching the same components.
+    for (std::size_t i = 0; i < index; i++) {
+        if (system->conflicts(*m_systems[i])) {
+            m_dependents[i].push_back(index);
+            m_dependencies[index]++;
+        }
+    }
+
+    m_systems.push_back(system);
+    return system;
+}
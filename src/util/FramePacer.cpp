@@ -0,0 +1,121 @@
+#include "util/FramePacer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+FramePacer::FramePacer(
+    std::stop_token stop,
+    TimerWheel &timers,
+    double rate,
+    Time::Duration spin
+)
+    : m_stop(stop)
+    , m_timers(timers)
+    , m_target(std::chrono::duration_cast<Time::Duration>(
+        std::chrono::duration<double>(1.0 / rate)
+    ))
+    , m_period(m_target)
+    , m_spin(spin)
+    , m_deadline(Time::now())
+    , m_presented()
+    , m_continuous(false)
+    , m_missed(false)
+    , m_blocked(0)
+    , m_blocked_interval(Time::Duration::zero())
+{}
+
+bool FramePacer::wait()
+{
+    Time::Timestamp now = Time::now();
+
+    // Frames waited for straight after presenting the last are measured,
+    // those after the caller was idle are not.
+    m_continuous = now - m_presented < m_period;
+
+    // Skip deadlines already missed, keeping to the same phase.
+    if (m_deadline < now)
+        m_deadline += m_period * ((now - m_deadline) / m_period);
+
+    if (now < m_deadline) {
+        // Timers run up to a tick late, so wake a tick before spinning. The
+        // flag is shared with the timer, which may still run after a stop.
+        Time::Duration early = m_spin + m_timers.resolution();
+        if (m_deadline - now > early) {
+            auto woken = std::make_shared<std::atomic<bool>>(false);
+            auto wake = [woken]{
+                *woken = true;
+                woken->notify_all();
+            };
+
+            m_timers.at(m_deadline - early, wake, m_stop.get_token());
+            std::stop_callback on_stop(m_stop.get_token(), wake);
+            woken->wait(false);
+        }
+
+        while (!m_stop && Time::now() < m_deadline)
+            std::this_thread::yield();
+
+        if (m_stop)
+            return false;
+
+        m_jitter.record(std::chrono::nanoseconds(Time::now() - m_deadline).count());
+    }
+
+    m_deadline += m_period;
+    return !m_stop;
+}
+
+void FramePacer::presented(Time::Duration blocked)
+{
+    Time::Timestamp now = Time::now();
+    Time::Duration interval = now - m_presented;
+    m_presented = now;
+
+    // The deadline was moved on to the next frame's when this one was waited
+    // for.
+    m_missed = now > m_deadline;
+
+    if (!m_continuous) {
+        m_blocked = 0;
+        return;
+    }
+
+    m_frame_times.record(std::chrono::nanoseconds(interval).count());
+
+    // Presenting that blocks for longer than the spin, frame after frame, is
+    // waiting for the display, so the frames are as far apart as refreshes.
+    if (blocked < m_spin) {
+        m_blocked = 0;
+        return;
+    }
+
+    m_blocked_interval = m_blocked == 0
+        ? interval
+        : (m_blocked_interval * 7 + interval) / 8;
+
+    if (++m_blocked == DETECT_FRAMES)
+        set_refresh(m_blocked_interval);
+}
+
+void FramePacer::set_refresh_rate(double rate)
+{
+    set_refresh(std::chrono::duration_cast<Time::Duration>(
+        std::chrono::duration<double>(1.0 / rate)
+    ));
+}
+
+void FramePacer::set_refresh(Time::Duration refresh)
+{
+    if (refresh <= Time::Duration::zero())
+        return;
+
+    double refreshes = std::round(
+        std::chrono::duration<double>(m_target) /
+        std::chrono::duration<double>(refresh)
+    );
+
+    m_period = refresh * (std::int64_t)std::max(refreshes, 1.0);
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <stop_token>
+
+#include "util/Histogram.h"
+#include "util/StopCondition.h"
+#include "util/Time.h"
+#include "util/TimerWheel.h"
+
+/**
+ * @brief Paces a render loop to a steady frame rate.
+ *
+ * Frames are scheduled against absolute deadlines a period apart, so time
+ * spent rendering does not lengthen the period. Waiting for a deadline sleeps
+ * until shortly before it, woken by a timer on a shared timer wheel, then
+ * spins for the remainder, as sleeping alone wakes late by the granularity of
+ * the OS scheduler.
+ *
+ * The period is a whole number of display refreshes once the refresh rate is
+ * known, either when set or when detected from presentation blocking on the
+ * display, so frames are not shown for uneven numbers of refreshes.
+ */
+class FramePacer
+{
+public:
+
+    /**
+     * @brief Create a frame pacer.
+     *
+     * @param stop A stop token to stop waiting on when requested.
+     * @param timers The timers to wake from sleep with. Must outlive the
+     * pacer.
+     * @param rate The target number of frames per second.
+     * @param spin How long before each deadline to stop sleeping and spin.
+     */
+    FramePacer(
+        std::stop_token stop,
+        TimerWheel &timers,
+        double rate = 144.0,
+        Time::Duration spin = 1ms
+    );
+
+    /**
+     * @brief Wait for the deadline of the next frame.
+     *
+     * Deadlines missed since the last frame, such as while the caller was
+     * idle, are skipped rather than rendered in a burst.
+     *
+     * @return If the frame should be rendered, or false if stopped.
+     */
+    bool wait();
+
+    /**
+     * @brief Mark the frame as presented to the display.
+     *
+     * @param blocked The time presenting the frame blocked for, which when
+     * consistently long means the display is throttling to its refresh rate.
+     */
+    void presented(Time::Duration blocked = Time::Duration::zero());
+
+    /**
+     * @brief Check if the last frame presented missed its deadline, being
+     * presented after the next frame was due.
+     *
+     * @return If the last frame took longer than its period.
+     */
+    inline bool missed() const {
+        return m_missed;
+    }
+
+    /**
+     * @brief Set the refresh rate of the display, making the period the whole
+     * number of refreshes nearest the target rate.
+     *
+     * @param rate The number of display refreshes per second.
+     */
+    void set_refresh_rate(double rate);
+
+    /**
+     * @brief Get the time between frame deadlines.
+     * @return The frame period.
+     */
+    inline Time::Duration period() const {
+        return m_period;
+    }
+
+    /**
+     * @brief Get the times between consecutive presented frames.
+     * @return A snapshot of the frame times in nanoseconds.
+     */
+    inline Histogram::Snapshot frame_times() const {
+        return m_frame_times.snapshot();
+    }
+
+    /**
+     * @brief Get how late each wait woke after its deadline.
+     * @return A snapshot of the jitter in nanoseconds.
+     */
+    inline Histogram::Snapshot jitter() const {
+        return m_jitter.snapshot();
+    }
+
+private:
+
+    /// The number of consecutive blocking presents detecting the refresh rate.
+    static const constexpr std::size_t DETECT_FRAMES = 16;
+
+    /**
+     * @brief Set the refresh period of the display and update the period.
+     * @param refresh The time between display refreshes.
+     */
+    void set_refresh(Time::Duration refresh);
+
+    /// Condition to sleep on between frames.
+    StopCondition m_stop;
+
+    /// The timers waking the pacer from sleep.
+    TimerWheel &m_timers;
+
+    /// The time between frames at the target rate.
+    Time::Duration m_target;
+
+    /// The time between frame deadlines.
+    Time::Duration m_period;
+
+    /// How long before each deadline to spin.
+    Time::Duration m_spin;
+
+    /// The deadline of the next frame.
+    Time::Timestamp m_deadline;
+
+    /// When the last frame was presented.
+    Time::Timestamp m_presented;
+
+    /// If the current frame was waited for straight after the last was
+    /// presented.
+    bool m_continuous;
+
+    /// If the last frame presented missed its deadline.
+    bool m_missed;
+
+    /// The number of consecutive frames whose present blocked.
+    std::size_t m_blocked;
+
+    /// The mean time between frames whose present blocked.
+    Time::Duration m_blocked_interval;
+
+    /// Times between consecutive presented frames, in nanoseconds.
+    Histogram m_frame_times;
+
+    /// How late each wait woke after its deadline, in nanoseconds.
+    Histogram m_jitter;
+};
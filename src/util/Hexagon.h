@@ -1,12 +1,14 @@
 #pragma once
 
 #include <iostream>
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <functional>
 #include <map>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 #define PI 3.141592653589793
 #define SQRT3 1.7320508075688772
@@ -324,6 +326,27 @@ public:
         const Hexagon<double> &hexagon
     ) const;
 
+    /**
+     * @brief Get every hexagon that intersects a cartesian rectangle.
+     * 
+     * The range of q is found from the hexagons at the corners of the
+     * rectangle, then the range of r for each q, so only hexagons near the
+     * rectangle are visited. Hexagons near but not touching the rectangle
+     * may be included.
+     * 
+     * @param left The smallest x coordinate of the rectangle.
+     * @param top The smallest y coordinate of the rectangle.
+     * @param right The largest x coordinate of the rectangle.
+     * @param bottom The largest y coordinate of the rectangle.
+     * @return The hexagons intersecting the rectangle.
+     */
+    std::vector<Hexagon<int>> range(
+        double left,
+        double top,
+        double right,
+        double bottom
+    ) const;
+
 private:
 
      /// The orientation type of the grid.
@@ -418,4 +441,76 @@ std::tuple<double, double> Grid<Type>::corner_offset(int corner) const
     );
 }
 
+template<GridType Type>
+std::vector<Hexagon<int>> Grid<Type>::range(
+    double left,
+    double top,
+    double right,
+    double bottom
+) const {
+    using O = Grid<Type>::Orientation;
+    auto [size_x, size_y] = m_size;
+    auto [origin_x, origin_y] = m_origin;
+
+    // Grow the rectangle by the size of a hexagon, so hexagons whose centre
+    // is outside it but which overlap it are included.
+    double margin = std::max(std::abs(size_x), std::abs(size_y));
+    left -= margin;
+    top -= margin;
+    right += margin;
+    bottom += margin;
+
+    // The q coordinate of hexagons with centres inside the rectangle is
+    // bounded by its value at the corners, as q is linear in x and y.
+    double q_min = INFINITY;
+    double q_max = -INFINITY;
+    for (auto [x, y] : {
+        std::make_tuple(left, top), std::make_tuple(right, top),
+        std::make_tuple(left, bottom), std::make_tuple(right, bottom)
+    }) {
+        double q = to_hexagon(x, y).q;
+        q_min = std::min(q_min, q);
+        q_max = std::max(q_max, q);
+    }
+
+    // Narrow the bounds of r so a centre at (q, r) is within [low, high] on
+    // an axis where it moves by factor * size per r from its position at r = 0.
+    auto bound = [](
+        double &r_min, double &r_max,
+        double at_zero, double factor,
+        double low, double high
+    ) {
+        if (factor == 0.0)
+            return;
+
+        double a = (low - at_zero) / factor;
+        double b = (high - at_zero) / factor;
+        r_min = std::max(r_min, std::min(a, b));
+        r_max = std::min(r_max, std::max(a, b));
+    };
+
+    std::vector<Hexagon<int>> hexagons;
+
+    for (int q = (int)std::ceil(q_min); q <= (int)std::floor(q_max); q++) {
+        double r_min = -INFINITY;
+        double r_max = INFINITY;
+
+        bound(
+            r_min, r_max,
+            O::f0 * q * size_x + origin_x, O::f1 * size_x,
+            left, right
+        );
+        bound(
+            r_min, r_max,
+            O::f2 * q * size_y + origin_y, O::f3 * size_y,
+            top, bottom
+        );
+
+        for (int r = (int)std::ceil(r_min); r <= (int)std::floor(r_max); r++)
+            hexagons.emplace_back(q, r);
+    }
+
+    return hexagons;
+}
+
 } // namespace Hexagon
@@ -0,0 +1,113 @@
+#include "util/Histogram.h"
+
+#include <algorithm>
+#include <bit>
+
+/// The number of bits kept of each value larger than the linear buckets.
+static const constexpr int SIGNIFICANT_BITS = std::bit_width(
+    Histogram::LINEAR_BUCKETS - 1
+);
+
+Histogram::Histogram()
+    : m_buckets()
+    , m_count(0)
+    , m_sum(0)
+    , m_min(UINT64_MAX)
+    , m_max(0)
+{}
+
+std::size_t Histogram::bucket(std::uint64_t value)
+{
+    if (value < LINEAR_BUCKETS)
+        return value;
+
+    // Keep the most significant bits of the value, the leading one of which is
+    // implied by the magnitude.
+    int width = std::bit_width(value);
+    std::uint64_t top = value >> (width - SIGNIFICANT_BITS);
+    std::size_t magnitude = width - SIGNIFICANT_BITS - 1;
+
+    return LINEAR_BUCKETS + magnitude * SUB_BUCKETS + (top - SUB_BUCKETS);
+}
+
+std::uint64_t Histogram::highest(std::size_t bucket)
+{
+    if (bucket < LINEAR_BUCKETS)
+        return bucket;
+
+    std::size_t magnitude = (bucket - LINEAR_BUCKETS) / SUB_BUCKETS;
+    std::uint64_t top = SUB_BUCKETS + (bucket - LINEAR_BUCKETS) % SUB_BUCKETS;
+    std::uint64_t step = std::uint64_t(1) << (magnitude + 1);
+
+    return top * step + (step - 1);
+}
+
+void Histogram::record(std::uint64_t value, std::uint64_t count)
+{
+    m_buckets[bucket(value)].fetch_add(count, std::memory_order_relaxed);
+    m_count.fetch_add(count, std::memory_order_relaxed);
+    m_sum.fetch_add(value * count, std::memory_order_relaxed);
+
+    std::uint64_t min = m_min.load(std::memory_order_relaxed);
+    while (value < min && !m_min.compare_exchange_weak(min, value));
+
+    std::uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value));
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot snapshot;
+
+    for (std::size_t i = 0; i < BUCKETS; i++)
+        snapshot.m_buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+
+    snapshot.m_count = m_count.load(std::memory_order_relaxed);
+    snapshot.m_sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.m_min = m_min.load(std::memory_order_relaxed);
+    snapshot.m_max = m_max.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+void Histogram::reset()
+{
+    for (auto &bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(UINT64_MAX, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t Histogram::Snapshot::percentile(double percentile) const
+{
+    if (m_count == 0)
+        return 0;
+
+    // The number of values at or below the percentile, at least one.
+    std::uint64_t target = (std::uint64_t)(percentile / 100.0 * m_count + 0.5);
+    if (target == 0)
+        target = 1;
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; i++) {
+        seen += m_buckets[i];
+        if (seen >= target)
+            return std::min(Histogram::highest(i), m_max);
+    }
+
+    return m_max;
+}
+
+void Histogram::Snapshot::merge(const Snapshot &other)
+{
+    for (std::size_t i = 0; i < BUCKETS; i++)
+        m_buckets[i] += other.m_buckets[i];
+
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief A lock free histogram of unsigned integer values with a bounded
+ * relative error, in the style of an HDR histogram.
+ *
+ * Values below LINEAR_BUCKETS are counted exactly. Larger values are counted in
+ * buckets that subdivide each power of two into SUB_BUCKETS linear buckets,
+ * so any recorded value is reported to within 1 / SUB_BUCKETS of its true
+ * value, over the full range of a 64 bit integer.
+ */
+class Histogram
+{
+public:
+
+    /// The number of buckets each power of two is subdivided into.
+    static const constexpr std::size_t SUB_BUCKETS = 16;
+
+    /// The number of buckets counting values exactly.
+    static const constexpr std::size_t LINEAR_BUCKETS = 2 * SUB_BUCKETS;
+
+    /// The total number of buckets needed to cover a 64 bit integer.
+    static const constexpr std::size_t BUCKETS = (
+        LINEAR_BUCKETS + (64 - 5) * SUB_BUCKETS
+    );
+
+    /**
+     * @brief A copy of the counts of a histogram at a point in time.
+     */
+    class Snapshot
+    {
+    public:
+
+        /**
+         * @brief Get the number of recorded values.
+         * @return The number of recorded values.
+         */
+        inline std::uint64_t count() const {
+            return m_count;
+        }
+
+        /**
+         * @brief Get the smallest recorded value.
+         * @return The smallest recorded value, or zero if none were recorded.
+         */
+        inline std::uint64_t min() const {
+            return m_count ? m_min : 0;
+        }
+
+        /**
+         * @brief Get the largest recorded value.
+         * @return The largest recorded value.
+         */
+        inline std::uint64_t max() const {
+            return m_max;
+        }
+
+        /**
+         * @brief Get the mean of the recorded values.
+         * @return The mean, or zero if no values were recorded.
+         */
+        inline double mean() const {
+            return m_count ? (double)m_sum / (double)m_count : 0.0;
+        }
+
+        /**
+         * @brief Get the value at a percentile of the recorded values.
+         *
+         * @param percentile The percentile in the range [0, 100].
+         * @return The highest value equivalent to the value at the percentile.
+         */
+        std::uint64_t percentile(double percentile) const;
+
+        /**
+         * @brief Combine the counts of another snapshot into this one.
+         * @param other The snapshot to add to this one.
+         */
+        void merge(const Snapshot &other);
+
+    private:
+
+        friend class Histogram;
+
+        /// The count of values in each bucket.
+        std::array<std::uint64_t, BUCKETS> m_buckets {};
+
+        /// The total number of recorded values.
+        std::uint64_t m_count = 0;
+
+        /// The sum of the recorded values.
+        std::uint64_t m_sum = 0;
+
+        /// The smallest recorded value.
+        std::uint64_t m_min = UINT64_MAX;
+
+        /// The largest recorded value.
+        std::uint64_t m_max = 0;
+    };
+
+    Histogram();
+
+    /**
+     * @brief Record a value. Safe to call concurrently.
+     * 
+     * @param value The value to record.
+     * @param count The number of times to record the value.
+     */
+    void record(std::uint64_t value, std::uint64_t count = 1);
+
+    /**
+     * @brief Copy the current counts of the histogram.
+     *
+     * The copy is not atomic with respect to concurrent calls to record(), so
+     * values recorded during the copy may or may not be included.
+     *
+     * @return A snapshot of the histogram.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Clear all recorded values.
+     */
+    void reset();
+
+    /**
+     * @brief Get the bucket a value is counted in.
+     *
+     * @param value The value to find the bucket of.
+     * @return The index of the bucket.
+     */
+    static std::size_t bucket(std::uint64_t value);
+
+    /**
+     * @brief Get the highest value counted in a bucket.
+     *
+     * @param bucket The index of the bucket.
+     * @return The highest value that is counted in the bucket.
+     */
+    static std::uint64_t highest(std::size_t bucket);
+
+private:
+
+    /// The count of values in each bucket.
+    std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets;
+
+    /// The total number of recorded values.
+    std::atomic<std::uint64_t> m_count;
+
+    /// The sum of the recorded values.
+    std::atomic<std::uint64_t> m_sum;
+
+    /// The smallest recorded value.
+    std::atomic<std::uint64_t> m_min;
+
+    /// The largest recorded value.
+    std::atomic<std::uint64_t> m_max;
+};
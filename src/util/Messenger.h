@@ -1,14 +1,29 @@
 #pragma once
 
 #include <mutex>
+#include <condition_variable>
 #include <tuple>
 #include <deque>
 #include <functional>
 #include <optional>
-#include <condition_variable>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <array>
+#include <memory>
+#include <ostream>
+#include <ranges>
+#include <algorithm>
+#include <span>
+#include <coroutine>
+#include <utility>
 
 #include "util/TypeList.h"
+#include "util/Histogram.h"
+#include "util/StopCondition.h"
+#include "util/Time.h"
+#include "util/ThreadPool.h"
 
 /**
  * @brief A class responsible for being an intermediary between code publishing
@@ -18,6 +33,20 @@
  * the messenger will use the same stream for both channels. Each type should
  * be a struct.
  * 
+ * Messages are dispatched by jobs on a thread pool, one job per batch. Messages
+ * of the same topic are dispatched one at a time in publishing order.
+ * 
+ * Each topic has its own typed channel, and the code dispatching each topic is
+ * generated at compile time, so subscribers are called directly with the
+ * message type without casting through void pointers.
+ * 
+ * Subscribers themselves are still held as std::function. They are lambdas of
+ * distinct types added and removed at runtime, often by code that does not
+ * know the messenger's full type, so a container per callable type would need
+ * every subscriber known when the messenger is declared. The erasure costs
+ * one indirect call per subscriber, which is small next to the channel lock
+ * taken for each batch.
+ * 
  * @tparam Topics A type list of the types of each message
  */
 template<typename Topics>
@@ -29,15 +58,16 @@ public:
      * @brief Construct a new Messenger object
      * 
      * @param stop A stop source to use if provided.
-     * @param threads The number of threads to handle messages with.
+     * @param pool The thread pool to handle messages with. Must outlive the
+     * messenger.
      */
     Messenger(
         std::optional<std::stop_source> stop = std::nullopt,
-        std::size_t threads = 4
+        ThreadPool &pool = ThreadPool::global()
     );
 
     /**
-     * @brief Stops the threads.
+     * @brief Stops dispatching and waits for running callbacks to return.
      */
     ~Messenger();
 
@@ -50,10 +80,42 @@ public:
      * @returns An integer identifier of the subscription.
      */
     template<std::size_t Topic>
-    void subscribe(
+    std::size_t subscribe(
         std::function<void(const TypeList::Get<Topics, Topic> &)> &&function
     );
 
+    /**
+     * @brief Subscribe to a topic, receiving messages published together in
+     * a batch with a single call.
+     * 
+     * Messages published individually are received in batches of one. Batch
+     * subscribers are called after the subscribers to single messages.
+     * 
+     * @tparam Topic The topic to subscribe to.
+     * @param function The function to callback on to receive the batch.
+     * 
+     * @returns An integer identifier of the subscription.
+     */
+    template<std::size_t Topic>
+    std::size_t subscribe_batch(
+        std::function<void(std::span<const TypeList::Get<Topics, Topic>>)>
+            &&function
+    );
+
+    /**
+     * @brief Remove a subscription to a topic.
+     * 
+     * Waits for a dispatch of the topic in progress to finish, so once this
+     * returns the subscriber is not called back and coroutines resumed by the
+     * topic have suspended again. Must not be called from a callback or
+     * coroutine of the same topic.
+     * 
+     * @tparam Topic The topic subscribed to.
+     * @param id The identifier returned when subscribing.
+     */
+    template<std::size_t Topic>
+    void unsubscribe(std::size_t id);
+
     /**
      * @brief Publish data to a topic.
      * 
@@ -76,79 +138,689 @@ public:
         );
     }
 
+    /**
+     * @brief Publish a range of data to a topic at once.
+     * 
+     * The batch is queued and dispatched as a single unit, so it costs one
+     * lock, one allocation and one notification regardless of its size. The
+     * messages are delivered in order.
+     * 
+     * @tparam Topic The topic to publish data to.
+     * @param range The data to publish to all subscribers.
+     */
+    template<std::size_t Topic, std::ranges::input_range Range>
+    void publish_batch(Range &&range);
+
+    /**
+     * @brief An awaitable of the next message published to a topic.
+     * 
+     * The awaiting coroutine is resumed on the messenger thread dispatching
+     * the message, after the subscribers have been called back. Awaiting
+     * coroutines are not resumed after the messenger is stopped.
+     * 
+     * @tparam Topic The topic to await a message from.
+     */
+    template<std::size_t Topic>
+    class Next;
+
+    /**
+     * @brief A subscription to a topic that buffers its messages until they
+     * are awaited, so none are missed between awaits.
+     * 
+     * @tparam Topic The topic to subscribe to.
+     */
+    template<std::size_t Topic>
+    class Stream;
+
+    /**
+     * @brief Await the next message published to a topic.
+     * 
+     * Only the first message of a batch is received.
+     * 
+     * @tparam Topic The topic to await a message from.
+     * @return An awaitable resulting in the message.
+     */
+    template<std::size_t Topic>
+    inline Next<Topic> next() {
+        return Next<Topic>(std::get<Topic>(m_channels));
+    }
+
+    /**
+     * @brief Create an asynchronous stream of the messages published to a
+     * topic from now on.
+     * 
+     * @tparam Topic The topic to stream.
+     * @return A stream of messages that can be awaited with next().
+     */
+    template<std::size_t Topic>
+    inline Stream<Topic> stream() {
+        return Stream<Topic>(*this);
+    }
+
+    /**
+     * @brief A function observing every batch of messages as it is published,
+     * given the topic, a pointer to the first message, the number of messages
+     * and when they were published.
+     */
+    using Observer = std::function<
+        void(std::size_t, const void*, std::size_t, Time::Timestamp)
+    >;
+
+    /**
+     * @brief Observe every message published to any topic.
+     * 
+     * Observers are called on the publishing thread in the order messages are
+     * published, while the queue is locked, so must be quick.
+     * 
+     * @param observer The function to call on each publish.
+     */
+    void observe(Observer &&observer);
+
+    /**
+     * @brief What happens to messages still queued after their deadline.
+     */
+    enum class Expiry
+    {
+        /// Stale messages are discarded.
+        DROP,
+
+        /// Stale messages are discarded except the most recent, which is
+        /// still delivered. Suits topics where only the latest state matters.
+        COALESCE
+    };
+
+    /**
+     * @brief Set the priority of a topic. Workers always take the next
+     * message from the highest priority topic that is not already being
+     * dispatched. Topics of equal priority are taken in topic order.
+     * 
+     * @tparam Topic The topic to prioritise.
+     * @param priority The priority, higher first. Topics default to zero.
+     */
+    template<std::size_t Topic>
+    void set_priority(int priority);
+
+    /**
+     * @brief Set how long messages of a topic may wait in the queue before
+     * they are considered stale.
+     * 
+     * Batches published together expire as a unit.
+     * 
+     * @tparam Topic The topic to set the deadline of.
+     * @param deadline The time after publishing that a message becomes stale.
+     * @param expiry What to do with stale messages.
+     */
+    template<std::size_t Topic>
+    void set_deadline(Time::Duration deadline, Expiry expiry = Expiry::DROP);
+
+    /**
+     * @brief Counters and latencies of the messages on a single topic.
+     *
+     * Latencies are in nanoseconds, measured from the call to publish().
+     */
+    struct TopicStatistics
+    {
+        /// The number of messages published to the topic.
+        std::uint64_t published;
+
+        /// The number of messages delivered to every subscriber.
+        std::uint64_t dispatched;
+
+        /// The number of messages not delivered to every subscriber.
+        std::uint64_t dropped;
+
+        /// The number of messages waiting to be dispatched.
+        std::size_t queue_depth;
+
+        /// The largest number of messages that have waited to be dispatched.
+        std::size_t max_queue_depth;
+
+        /// Latency until the first callback is started.
+        Histogram::Snapshot dispatch_latency;
+
+        /// Latency until the last callback has returned.
+        Histogram::Snapshot completion_latency;
+    };
+
+    /**
+     * @brief The statistics of every topic, indexed by topic.
+     */
+    using Statistics = std::array<TopicStatistics, TypeList::Size<Topics>>;
+
+    /**
+     * @brief Get a snapshot of the statistics of every topic.
+     * @return The statistics of each topic.
+     */
+    Statistics statistics() const;
+
+    /**
+     * @brief Write the statistics of every topic to a stream, one line per
+     * topic.
+     *
+     * @param out The stream to write to.
+     */
+    void write_statistics(std::ostream &out) const;
+
+    /**
+     * @brief Wait until every message published so far has been dispatched
+     * or dropped, and no job dispatching them is still running.
+     *
+     * Must not be called from a callback.
+     */
+    void wait_idle();
+
+    /**
+     * @brief Periodically write the statistics of every topic to a stream
+     * until the messenger is stopped.
+     *
+     * Replaces any previous logging.
+     *
+     * @param out The stream to write to. Must outlive the messenger.
+     * @param period The time between writes.
+     */
+    void log_statistics(std::ostream &out, Time::Duration period);
+
 private:
 
+    /**
+     * @brief A batch of messages waiting in a queue to be processed.
+     */
+    template<typename Message>
+    struct Envelope
+    {
+        /// The first message of the batch, contiguous with the rest.
+        std::shared_ptr<const Message> message;
+
+        /// The number of messages in the batch.
+        std::size_t count = 0;
+
+        /// When the message was published.
+        Time::Timestamp published;
+    };
+
+    /**
+     * @brief A subscriber to a channel.
+     */
+    template<typename Function>
+    struct Subscription
+    {
+        /// The identifier returned when subscribing.
+        std::size_t id;
+
+        /// The function called back.
+        Function function;
+    };
+
+    /**
+     * @brief A coroutine waiting for the next message of a channel, shared
+     * between the awaitable and the channel so that either may go first.
+     */
+    template<typename Message>
+    struct Waiter
+    {
+        /// Mutex protecting the handle and message.
+        std::mutex mutex;
+
+        /// The waiting coroutine, cleared once claimed for resuming or when
+        /// the awaitable is destroyed.
+        std::coroutine_handle<> handle;
+
+        /// The message, set before the coroutine is resumed.
+        std::optional<Message> message;
+    };
+
     /**
      * @brief Channel type.
      */
+    template<typename Message>
     struct Channel
     {
         // Mutex protecting concurrent calling back of call backs.
         std::mutex mutex;
 
-        // Callbacks on each message.
-        std::vector<std::function<void(void*)>> callbacks;
+        // Callbacks on each message, type erased as subscribers are added at
+        // runtime.
+        std::vector<
+            Subscription<std::function<void(const Message &)>>
+        > callbacks;
+
+        // Callbacks on each batch of messages.
+        std::vector<
+            Subscription<std::function<void(std::span<const Message>)>>
+        > batch_callbacks;
+
+        /// The identifier of the next subscription, protected by mutex.
+        std::size_t next_id = 0;
+
+        /// The number of messages published to the channel.
+        std::atomic<std::uint64_t> published {0};
+
+        /// The number of messages delivered to every callback.
+        std::atomic<std::uint64_t> dispatched {0};
+
+        /// The number of messages not delivered to every callback.
+        std::atomic<std::uint64_t> dropped {0};
+
+        /// The number of messages in the queue.
+        std::atomic<std::size_t> depth {0};
+
+        /// The largest number of messages that have been in the queue.
+        std::atomic<std::size_t> max_depth {0};
+
+        /// Latency from publishing to the first callback starting.
+        Histogram dispatch_latency;
+
+        /// Latency from publishing to the last callback returning.
+        Histogram completion_latency;
+
+        /// Messages waiting to be processed, protected by m_mutex.
+        std::deque<Envelope<Message>> queue;
+
+        /// The time messages may wait, protected by m_mutex.
+        std::optional<Time::Duration> deadline;
+
+        /// What to do with messages that pass the deadline.
+        Expiry expiry = Expiry::DROP;
+
+        /// The batch taken from the queue to dispatch, protected by mutex.
+        Envelope<Message> current;
+
+        /// Mutex protecting the waiters.
+        std::mutex waiters_mutex;
+
+        /// Coroutines waiting for the next message.
+        std::vector<std::shared_ptr<Waiter<Message>>> waiters;
     };
 
     /**
-     * @brief Thread of each worker processing messages.
+     * @brief Meta function from a message type to its channel type.
+     */
+    template<typename Message>
+    struct ChannelOf {
+        using type = Channel<Message>;
+    };
+
+    /**
+     * @brief Submit a job to the pool that processes the next message.
+     */
+    void schedule();
+
+    /**
+     * @brief Job dispatching the next available message, highest priority
+     * first, if any.
+     */
+    void process();
+
+    /**
+     * @brief Add a batch of messages to the queue and notify the workers.
      * 
-     * @param stop A stop token to stop the worker thread.
+     * @tparam Topic The topic the messages belong to.
+     * @param message Pointer to the first message of the batch.
+     * @param count The number of messages in the batch.
      */
-    void worker(std::stop_token stop);
+    template<std::size_t Topic>
+    void enqueue(
+        std::shared_ptr<const TypeList::Get<Topics, Topic>> message,
+        std::size_t count
+    );
+
+    /**
+     * @brief Remove the stale messages from the front of a topic queue, then
+     * take the next message if the channel is free. Requires m_mutex to be
+     * locked.
+     * 
+     * @tparam Topic The topic to take a message from.
+     * @param now The current time.
+     * @param channel_lock Set to the lock of the channel on success.
+     * 
+     * @return If a message was taken.
+     */
+    template<std::size_t Topic>
+    bool take(Time::Timestamp now, std::unique_lock<std::mutex> &channel_lock);
+
+    /**
+     * @brief Call back the subscribers of a topic with the taken message.
+     * Requires the channel to be locked.
+     * 
+     * @tparam Topic The topic to dispatch.
+     * @param stop A stop token to stop dispatching early.
+     */
+    template<std::size_t Topic>
+    void dispatch(std::stop_token stop);
+
+    /**
+     * @brief Get the statistics of a topic.
+     * 
+     * @tparam Topic The topic to get the statistics of.
+     * @return The statistics of the topic.
+     */
+    template<std::size_t Topic>
+    TopicStatistics topic_statistics() const;
+
+    /**
+     * @brief Sort the topics by priority. Requires m_mutex to be locked.
+     */
+    void reorder();
 
     /// Channels for each topic.
-    std::array<Channel, TypeList::Size<Topics>> m_channels;
+    TypeList::TupleOf<TypeList::Transform<Topics, ChannelOf>> m_channels;
+
+    /// The priority of each topic, protected by m_mutex.
+    std::array<int, TypeList::Size<Topics>> m_priorities {};
 
-    /// Queues of messages to be processed.
-    std::deque<std::pair<std::size_t, std::shared_ptr<void>>> m_queue;
+    /// Topics in the order workers check them for messages.
+    std::array<std::size_t, TypeList::Size<Topics>> m_order;
 
-    /// Mutex protecting concurrent access to m_queue and condition variable.
+    /// Observers of every publish, protected by m_mutex.
+    std::vector<Observer> m_observers;
+
+    /// The number of batches in all the channel queues.
+    std::size_t m_pending = 0;
+
+    /// Mutex protecting the channel queues.
     std::mutex m_mutex;
 
-    /// Condition workers wait on.
-    std::condition_variable_any m_condition;
+    /// The pool running the jobs dispatching messages.
+    ThreadPool &m_pool;
+
+    /**
+     * @brief The jobs submitted to the pool that have not finished, shared
+     * with each job so that the last can notify after the messenger is gone.
+     */
+    struct Jobs
+    {
+        /// Mutex protecting the count.
+        std::mutex mutex;
 
-    /// Threads handling messages.
-    std::vector<std::jthread> m_workers;
+        /// Condition notified when the count reaches zero.
+        std::condition_variable condition;
+
+        /// The number of jobs not yet finished.
+        std::size_t count = 0;
+    };
+
+    /// The jobs submitted to the pool that have not finished.
+    std::shared_ptr<Jobs> m_jobs = std::make_shared<Jobs>();
 
     /// Source for stopping the messaging.
     std::stop_source m_stop_source;
+
+    /// Thread periodically logging statistics.
+    std::jthread m_logger;
+};
+
+template<typename Topics>
+template<std::size_t Topic>
+class Messenger<Topics>::Next
+{
+public:
+
+    using Message = TypeList::Get<Topics, Topic>;
+
+    /**
+     * @brief Stop waiting if the awaiting coroutine is destroyed first.
+     */
+    ~Next() {
+        {
+            std::scoped_lock lock(m_channel.waiters_mutex);
+            std::erase(m_channel.waiters, m_waiter);
+        }
+
+        // A dispatch may have already taken the waiter from the channel.
+        std::scoped_lock lock(m_waiter->mutex);
+        m_waiter->handle = nullptr;
+    }
+
+    inline bool await_ready() const noexcept {
+        return false;
+    }
+
+    inline void await_suspend(std::coroutine_handle<> handle) {
+        {
+            std::scoped_lock lock(m_waiter->mutex);
+            m_waiter->handle = handle;
+        }
+
+        std::scoped_lock lock(m_channel.waiters_mutex);
+        m_channel.waiters.push_back(m_waiter);
+    }
+
+    inline Message await_resume() {
+        std::scoped_lock lock(m_waiter->mutex);
+        return std::move(*m_waiter->message);
+    }
+
+private:
+
+    friend class Messenger;
+
+    /**
+     * @brief Create an awaitable of the next message of a channel.
+     * @param channel The channel of the topic.
+     */
+    inline explicit Next(Channel<Message> &channel)
+        : m_channel(channel)
+        , m_waiter(std::make_shared<Waiter<Message>>())
+    {}
+
+    /// The channel of the topic.
+    Channel<Message> &m_channel;
+
+    /// The registration of the awaiting coroutine.
+    std::shared_ptr<Waiter<Message>> m_waiter;
+};
+
+template<typename Topics>
+template<std::size_t Topic>
+class Messenger<Topics>::Stream
+{
+public:
+
+    using Message = TypeList::Get<Topics, Topic>;
+
+    /**
+     * @brief Awaitable of the next message in the stream.
+     */
+    class Awaiter
+    {
+    public:
+
+        inline bool await_ready() {
+            std::scoped_lock lock(m_stream.m_state->mutex);
+            return !m_stream.m_state->buffer.empty();
+        }
+
+        inline bool await_suspend(std::coroutine_handle<> handle) {
+            std::scoped_lock lock(m_stream.m_state->mutex);
+            if (!m_stream.m_state->buffer.empty())
+                return false;
+
+            m_stream.m_state->waiting = handle;
+            return true;
+        }
+
+        inline Message await_resume() {
+            std::scoped_lock lock(m_stream.m_state->mutex);
+            Message message = std::move(m_stream.m_state->buffer.front());
+            m_stream.m_state->buffer.pop_front();
+            return message;
+        }
+
+    private:
+
+        friend class Stream;
+
+        inline explicit Awaiter(Stream &stream)
+            : m_stream(stream)
+        {}
+
+        /// The stream being awaited.
+        Stream &m_stream;
+    };
+
+    Stream(Stream &&other) = default;
+
+    /**
+     * @brief Stop resuming the awaiting coroutine.
+     */
+    ~Stream() {
+        if (m_state) {
+            std::scoped_lock lock(m_state->mutex);
+            m_state->waiting = nullptr;
+        }
+    }
+
+    /**
+     * @brief Unsubscribe the stream, waiting for a coroutine it is resuming to
+     * suspend again. Afterwards the awaiting coroutine may be destroyed.
+     * 
+     * Must not be called from a coroutine awaiting the stream.
+     */
+    void close() {
+        if (!m_state)
+            return;
+
+        m_messenger->unsubscribe<Topic>(m_subscription);
+
+        std::scoped_lock lock(m_state->mutex);
+        m_state->waiting = nullptr;
+    }
+
+    /**
+     * @brief Await the next message in the stream.
+     * @return An awaitable resulting in the message.
+     */
+    inline Awaiter next() {
+        return Awaiter(*this);
+    }
+
+private:
+
+    friend class Messenger;
+
+    /**
+     * @brief Buffered messages shared with the subscription, which may outlive
+     * the stream.
+     */
+    struct State
+    {
+        /// Mutex protecting the buffer and waiting coroutine.
+        std::mutex mutex;
+
+        /// Messages not yet awaited.
+        std::deque<Message> buffer;
+
+        /// The coroutine waiting for a message.
+        std::coroutine_handle<> waiting;
+    };
+
+    /**
+     * @brief Subscribe a stream to a topic.
+     * @param messenger The messenger to subscribe to.
+     */
+    explicit Stream(Messenger &messenger)
+        : m_messenger(&messenger)
+        , m_state(std::make_shared<State>())
+    {
+        m_subscription = messenger.subscribe_batch<Topic>(
+            [weak = std::weak_ptr<State>(m_state)](
+                std::span<const Message> messages
+            ) {
+                auto state = weak.lock();
+                if (!state)
+                    return;
+
+                std::coroutine_handle<> waiting;
+                {
+                    std::scoped_lock lock(state->mutex);
+                    state->buffer.insert(
+                        state->buffer.end(),
+                        messages.begin(),
+                        messages.end()
+                    );
+                    waiting = std::exchange(state->waiting, nullptr);
+                }
+
+                if (waiting)
+                    waiting.resume();
+            }
+        );
+    }
+
+    /// The messenger subscribed to.
+    Messenger *m_messenger;
+
+    /// The identifier of the subscription.
+    std::size_t m_subscription = 0;
+
+    /// The state of the stream.
+    std::shared_ptr<State> m_state;
 };
 
 template<typename Topics>
 Messenger<Topics>::Messenger(
     std::optional<std::stop_source> stop,
-    std::size_t threads
-) {
+    ThreadPool &pool
+)
+    : m_pool(pool)
+{
     if (stop) {
         m_stop_source = stop.value();
     }
 
-    for (std::size_t i = 0; i < threads; i++) {
-        m_workers.push_back(
-            std::jthread(&Messenger::worker, this, m_stop_source.get_token())
-        );
-    }
+    reorder();
 }
 
 template<typename Topics>
 Messenger<Topics>::~Messenger()
 {
     m_stop_source.request_stop();
+
+    // Jobs still queued on the pool return as soon as they run, or are
+    // cancelled if the pool stops first.
+    std::unique_lock lock(m_jobs->mutex);
+    m_jobs->condition.wait(lock, [this]{ return m_jobs->count == 0; });
 }
 
 template<typename Topics>
 template<std::size_t Topic>
-void Messenger<Topics>::subscribe(
+std::size_t Messenger<Topics>::subscribe(
     std::function<void(const TypeList::Get<Topics, Topic> &)> &&function
 ) {
+    auto &channel = std::get<Topic>(m_channels);
+
     // Lock the vector of callbacks for updating.
-    std::scoped_lock lock(std::get<Topic>(m_channels).mutex);
-    std::get<Topic>(m_channels).callbacks.push_back(
-        [function](void *message){
-            function(*static_cast<TypeList::Get<Topics, Topic>*>(message));
-        }
+    std::scoped_lock lock(channel.mutex);
+    channel.callbacks.push_back({channel.next_id, std::move(function)});
+    return channel.next_id++;
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+std::size_t Messenger<Topics>::subscribe_batch(
+    std::function<void(std::span<const TypeList::Get<Topics, Topic>>)>
+        &&function
+) {
+    auto &channel = std::get<Topic>(m_channels);
+
+    // Lock the vector of callbacks for updating.
+    std::scoped_lock lock(channel.mutex);
+    channel.batch_callbacks.push_back({channel.next_id, std::move(function)});
+    return channel.next_id++;
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+void Messenger<Topics>::unsubscribe(std::size_t id)
+{
+    auto &channel = std::get<Topic>(m_channels);
+
+    // The channel is locked for the whole of each dispatch.
+    std::scoped_lock lock(channel.mutex);
+    std::erase_if(channel.callbacks, [id](const auto &s) { return s.id == id; });
+    std::erase_if(
+        channel.batch_callbacks,
+        [id](const auto &s) { return s.id == id; }
     );
 }
 
@@ -156,86 +828,360 @@ template<typename Topics>
 template<std::size_t Topic>
 void Messenger<Topics>::publish(TypeList::Get<Topics, Topic> &&message)
 {
+    enqueue<Topic>(
+        std::make_shared<const TypeList::Get<Topics, Topic>>(std::move(message)),
+        1
+    );
+}
+
+template<typename Topics>
+template<std::size_t Topic, std::ranges::input_range Range>
+void Messenger<Topics>::publish_batch(Range &&range)
+{
+    using Message = TypeList::Get<Topics, Topic>;
+
+    // One allocation holds the whole batch, kept alive by an aliasing pointer
+    // to its first message.
+    auto batch = std::make_shared<std::vector<Message>>(
+        std::ranges::begin(range),
+        std::ranges::end(range)
+    );
+
+    if (batch->empty())
+        return;
+
+    std::size_t count = batch->size();
+    enqueue<Topic>(
+        std::shared_ptr<const Message>(batch, batch->data()),
+        count
+    );
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+void Messenger<Topics>::enqueue(
+    std::shared_ptr<const TypeList::Get<Topics, Topic>> message,
+    std::size_t count
+) {
+    auto &channel = std::get<Topic>(m_channels);
+
     {
         std::scoped_lock lock(m_mutex);
-        m_queue.emplace_back(std::make_pair(
-            Topic,
-            std::make_shared<TypeList::Get<Topics, Topic>>(message)
-        ));
+        auto &envelope = channel.queue.emplace_back(
+            std::move(message),
+            count,
+            Time::now()
+        );
+        ++m_pending;
+
+        for (const auto &observer : m_observers)
+            observer(Topic, envelope.message.get(), count, envelope.published);
+
+        std::size_t depth = channel.depth += count;
+        if (depth > channel.max_depth)
+            channel.max_depth = depth;
+    }
+
+    channel.published.fetch_add(count, std::memory_order_relaxed);
+    schedule();
+}
+
+template<typename Topics>
+void Messenger<Topics>::observe(Observer &&observer)
+{
+    std::scoped_lock lock(m_mutex);
+    m_observers.push_back(std::move(observer));
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+void Messenger<Topics>::set_priority(int priority)
+{
+    std::scoped_lock lock(m_mutex);
+    m_priorities[Topic] = priority;
+    reorder();
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+void Messenger<Topics>::set_deadline(Time::Duration deadline, Expiry expiry)
+{
+    std::scoped_lock lock(m_mutex);
+    std::get<Topic>(m_channels).deadline = deadline;
+    std::get<Topic>(m_channels).expiry = expiry;
+}
+
+template<typename Topics>
+void Messenger<Topics>::reorder()
+{
+    for (std::size_t topic = 0; topic < m_order.size(); topic++)
+        m_order[topic] = topic;
+
+    std::stable_sort(
+        m_order.begin(),
+        m_order.end(),
+        [this](std::size_t a, std::size_t b) {
+            return m_priorities[a] > m_priorities[b];
+        }
+    );
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+bool Messenger<Topics>::take(
+    Time::Timestamp now,
+    std::unique_lock<std::mutex> &channel_lock
+) {
+    auto &channel = std::get<Topic>(m_channels);
+
+    if (channel.deadline) {
+        auto stale = [&](const auto &envelope) {
+            return envelope.published + *channel.deadline < now;
+        };
+
+        // When coalescing, the newest stale message is kept.
+        bool keep = channel.expiry == Expiry::COALESCE;
+
+        while (!channel.queue.empty() && stale(channel.queue.front())) {
+            if (keep && (channel.queue.size() == 1 || !stale(channel.queue[1])))
+                break;
+
+            std::size_t count = channel.queue.front().count;
+            channel.queue.pop_front();
+            channel.depth -= count;
+            channel.dropped.fetch_add(count, std::memory_order_relaxed);
+            --m_pending;
+        }
     }
 
-    m_condition.notify_all();
+    if (channel.queue.empty())
+        return false;
+
+    // If another thread has the topic lock then it will get this message after
+    // it has finished its own.
+    channel_lock = std::unique_lock(channel.mutex, std::try_to_lock);
+    if (!channel_lock)
+        return false;
+
+    channel.current = std::move(channel.queue.front());
+    channel.queue.pop_front();
+    channel.depth -= channel.current.count;
+    --m_pending;
+
+    return true;
 }
 
 template<typename Topics>
-void Messenger<Topics>::worker(std::stop_token stop)
+template<std::size_t Topic>
+void Messenger<Topics>::dispatch(std::stop_token stop)
 {
-    using namespace std::chrono_literals;
+    auto &channel = std::get<Topic>(m_channels);
+    auto envelope = std::move(channel.current);
 
-    while (!stop.stop_requested()) {
+    channel.dispatch_latency.record(
+        std::chrono::nanoseconds(Time::now() - envelope.published).count(),
+        envelope.count
+    );
 
-        // Pointer to the message when found.
-        std::shared_ptr<void> message {nullptr};
+    for (const auto &subscription : channel.callbacks) {
+        if (stop.stop_requested()) {
+            channel.dropped.fetch_add(envelope.count, std::memory_order_relaxed);
+            return;
+        }
 
-        // The topic the message belongs to.
-        std::size_t topic {0};
+        for (std::size_t i = 0; i < envelope.count; i++)
+            subscription.function(envelope.message.get()[i]);
+    }
 
-        // Lock on the channel to ensure no two threads are calling back on two
-        // messages at the same time and potentially out of order.
-        std::unique_lock<std::mutex> channel_lock {};
+    for (const auto &subscription : channel.batch_callbacks) {
+        if (stop.stop_requested()) {
+            channel.dropped.fetch_add(envelope.count, std::memory_order_relaxed);
+            return;
+        }
 
-        // If a message was found and needs to be processed. Prevents busy loop
-        // checking for messages in queue when no channel is able to be locked.
-        bool found = false;
+        subscription.function({envelope.message.get(), envelope.count});
+    }
 
+    // Coroutines awaiting again while resumed wait for the next message.
+    std::vector<std::shared_ptr<Waiter<TypeList::Get<Topics, Topic>>>> waiters;
+    {
+        std::scoped_lock lock(channel.waiters_mutex);
+        waiters.swap(channel.waiters);
+    }
+
+    for (const auto &waiter : waiters) {
+        // Claim the coroutine, unless its awaitable was destroyed since.
+        std::coroutine_handle<> handle;
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
+            std::scoped_lock lock(waiter->mutex);
+            handle = std::exchange(waiter->handle, nullptr);
+            if (handle)
+                waiter->message = envelope.message.get()[0];
+        }
+
+        if (handle)
+            handle.resume();
+    }
+
+    channel.completion_latency.record(
+        std::chrono::nanoseconds(Time::now() - envelope.published).count(),
+        envelope.count
+    );
+    channel.dispatched.fetch_add(envelope.count, std::memory_order_relaxed);
+}
 
-            while (m_queue.empty()) {
+template<typename Topics>
+template<std::size_t Topic>
+typename Messenger<Topics>::TopicStatistics
+Messenger<Topics>::topic_statistics() const
+{
+    const auto &channel = std::get<Topic>(m_channels);
 
-                // Wait until the stop is signalled or a message exists.
-                m_condition.wait(lock, stop, [&]{ return !m_queue.empty(); });
+    return TopicStatistics{
+        channel.published.load(std::memory_order_relaxed),
+        channel.dispatched.load(std::memory_order_relaxed),
+        channel.dropped.load(std::memory_order_relaxed),
+        channel.depth.load(std::memory_order_relaxed),
+        channel.max_depth.load(std::memory_order_relaxed),
+        channel.dispatch_latency.snapshot(),
+        channel.completion_latency.snapshot()
+    };
+}
 
-                // Stop when requested.
-                if (stop.stop_requested()) {
-                    return;
-                }
-            }
+template<typename Topics>
+typename Messenger<Topics>::Statistics Messenger<Topics>::statistics() const
+{
+    return [this]<std::size_t... Topic>(std::index_sequence<Topic...>) {
+        return Statistics{topic_statistics<Topic>()...};
+    }(std::make_index_sequence<TypeList::Size<Topics>>());
+}
 
-            // Find next available message.
-            for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+template<typename Topics>
+void Messenger<Topics>::write_statistics(std::ostream &out) const
+{
+    // Latencies are written in microseconds.
+    auto us = [](std::uint64_t ns){ return (double)ns / 1000.0; };
 
-                // If another thread has the topic lock then it will get this me
-                channel_lock = std::unique_lock(
-                    m_channels[it->first].mutex,
-                    std::try_to_lock
-                );
+    auto statistics = this->statistics();
+    for (std::size_t topic = 0; topic < statistics.size(); topic++) {
+        const auto &s = statistics[topic];
+        out << "Messenger topic " << topic
+            << ": published " << s.published
+            << ", dispatched " << s.dispatched
+            << ", dropped " << s.dropped
+            << ", depth " << s.queue_depth
+            << " (max " << s.max_queue_depth << ")"
+            << ", dispatch p50/p99/max "
+            << us(s.dispatch_latency.percentile(50)) << "/"
+            << us(s.dispatch_latency.percentile(99)) << "/"
+            << us(s.dispatch_latency.max()) << "us"
+            << ", completion p50/p99/max "
+            << us(s.completion_latency.percentile(50)) << "/"
+            << us(s.completion_latency.percentile(99)) << "/"
+            << us(s.completion_latency.max()) << "us\n";
+    }
+    out.flush();
+}
 
-                if (!channel_lock)
-                    continue;
+template<typename Topics>
+void Messenger<Topics>::wait_idle()
+{
+    // Every published batch schedules a job, and a job leaving messages
+    // behind schedules another, so none are left once no jobs are.
+    std::unique_lock lock(m_jobs->mutex);
+    m_jobs->condition.wait(lock, [this]{ return m_jobs->count == 0; });
+}
 
-                // Remove the message from the queue.
-                std::tie(topic, message) = *it;
-                m_queue.erase(it);
+template<typename Topics>
+void Messenger<Topics>::log_statistics(std::ostream &out, Time::Duration period)
+{
+    m_logger = std::jthread([this, &out, period](std::stop_token stop){
+        StopCondition condition(stop);
 
-                // A message is ready to be processed.
-                found = true;
+        for (auto next = Time::now() + period; !condition; next += period) {
+            condition.wait_until(next);
+            if (condition)
                 break;
-            }
-        }
 
-        // If no message was found to process then wait for a bit to prevent
-        // busy loop and continue.
-        if (!found) {
-            std::this_thread::sleep_for(1ms);
-            continue;
+            write_statistics(out);
         }
+    });
+}
+
+template<typename Topics>
+void Messenger<Topics>::schedule()
+{
+    {
+        std::scoped_lock lock(m_jobs->mutex);
+        ++m_jobs->count;
+    }
+
+    // The job keeps the count alive itself, as the messenger may be destroyed
+    // as soon as the count reaches zero.
+    m_pool.submit([this, jobs = m_jobs](std::stop_token stop) {
+        // A cancelled job must not touch the messenger.
+        if (!stop.stop_requested())
+            process();
+
+        std::scoped_lock lock(jobs->mutex);
+        if (--jobs->count == 0)
+            jobs->condition.notify_all();
+    });
+}
+
+template<typename Topics>
+void Messenger<Topics>::process()
+{
+    constexpr auto TOPICS = std::make_index_sequence<TypeList::Size<Topics>>();
+
+    std::stop_token stop = m_stop_source.get_token();
+    if (stop.stop_requested())
+        return;
+
+    // The topic of the message when found.
+    std::size_t topic {0};
+
+    // Lock on the channel to ensure no two threads are calling back on two
+    // messages at the same time and potentially out of order.
+    std::unique_lock<std::mutex> channel_lock {};
 
-        for (const auto &function : m_channels[topic].callbacks) {
-            if (stop.stop_requested())
-                return;
+    // If a message was found. When every topic with messages is already being
+    // dispatched, the job finishing each will schedule another.
+    bool found = false;
 
-            function(message.get());
+    {
+        std::scoped_lock lock(m_mutex);
+        Time::Timestamp now = Time::now();
+
+        // Find the next available message, highest priority first. Each
+        // topic is a direct call, the fold stopping at the matching one.
+        for (std::size_t next : m_order) {
+            found = [&]<std::size_t... Topic>(std::index_sequence<Topic...>) {
+                return ((next == Topic && take<Topic>(now, channel_lock)) || ...);
+            }(TOPICS);
+
+            if (found) {
+                topic = next;
+                break;
+            }
         }
     }
+
+    if (!found)
+        return;
+
+    [&]<std::size_t... Topic>(std::index_sequence<Topic...>) {
+        ((topic == Topic && (dispatch<Topic>(stop), true)) || ...);
+    }(TOPICS);
+    channel_lock.unlock();
+
+    // Messages of this topic may have been skipped while it was locked.
+    bool pending;
+    {
+        std::scoped_lock lock(m_mutex);
+        pending = m_pending != 0;
+    }
+
+    if (pending)
+        schedule();
 }
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+#include <utility>
+
+#include "util/StopCondition.h"
+
+/**
+ * @brief A value that threads can wait on to change, woken exactly when it is
+ * set rather than polling it.
+ *
+ * Every change increments a version, so a waiter that has seen one version
+ * can wait for any later change without missing one made between waits.
+ *
+ * @tparam T The type of the value.
+ */
+template<typename T>
+class Observable
+{
+public:
+
+    /**
+     * @brief Create an observable value.
+     *
+     * @param stop A stop token to stop waiting on when requested.
+     * @param value The initial value.
+     */
+    Observable(std::stop_token stop, T value = T())
+        : m_condition(stop)
+        , m_value(std::move(value))
+        , m_version(0)
+    {}
+
+    /**
+     * @brief Get a copy of the value.
+     * @return The current value.
+     */
+    inline T get() {
+        auto lock = m_condition.lock();
+        return m_value;
+    }
+
+    /**
+     * @brief Get the number of times the value has changed.
+     * @return The current version.
+     */
+    inline std::uint64_t version() {
+        auto lock = m_condition.lock();
+        return m_version;
+    }
+
+    /**
+     * @brief Set the value and wake waiters.
+     * @param value The new value.
+     */
+    inline void set(T value) {
+        m_condition.notify_all([&]{
+            m_value = std::move(value);
+            m_version++;
+        });
+    }
+
+    /**
+     * @brief Change the value in place and wake waiters.
+     * @param update A function changing the value given a reference to it.
+     */
+    inline void update(const std::function<void(T&)> &update) {
+        m_condition.notify_all([&]{
+            update(m_value);
+            m_version++;
+        });
+    }
+
+    /**
+     * @brief Wait for the value to satisfy a predicate or the stop signal.
+     *
+     * @param ready A function given the value returning true to stop waiting.
+     * @return The value when waiting stopped.
+     */
+    inline T wait(const std::function<bool(const T&)> &ready) {
+        auto lock = m_condition.wait([&]{ return ready(m_value); });
+        return m_value;
+    }
+
+    /**
+     * @brief Wait for the value to change from a version or the stop signal.
+     *
+     * @param version The last version seen, set to the version when waiting
+     * stopped.
+     * @return The value when waiting stopped.
+     */
+    inline T wait_changed(std::uint64_t &version) {
+        auto lock = m_condition.wait([&]{ return m_version != version; });
+        version = m_version;
+        return m_value;
+    }
+
+    /**
+     * @brief Wait for the value to change from a version, a timestamp or the
+     * stop signal.
+     *
+     * @param version The last version seen, set to the version when waiting
+     * stopped.
+     * @param timestamp The timestamp at which to stop waiting.
+     * @return The value when waiting stopped.
+     */
+    inline T wait_changed_until(
+        std::uint64_t &version,
+        Time::Timestamp timestamp
+    ) {
+        auto lock = m_condition.wait_until(
+            timestamp,
+            [&]{ return m_version != version; }
+        );
+        version = m_version;
+        return m_value;
+    }
+
+private:
+
+    /// Condition waiters wait on, whose mutex protects the value.
+    StopCondition m_condition;
+
+    /// The value.
+    T m_value;
+
+    /// The number of times the value has changed.
+    std::uint64_t m_version;
+};
+
+/**
+ * @brief A flag that threads can wait on to be raised.
+ */
+using Flag = Observable<bool>;
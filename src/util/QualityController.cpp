@@ -0,0 +1,57 @@
+#include "util/QualityController.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+QualityController::QualityController(std::vector<Level> levels)
+    : m_levels(std::move(levels))
+    , m_level(0)
+    , m_cost(Time::Duration::zero())
+    , m_frames(0)
+    , m_slow(0)
+    , m_fast(0)
+    , m_backoff(m_levels.size(), 0)
+{
+    assert(!m_levels.empty() && "No levels of quality.");
+}
+
+bool QualityController::record(Time::Duration cost, Time::Duration budget)
+{
+    // Average over a few frames so a single slow frame does not lower the
+    // quality, starting afresh at each level.
+    m_cost = m_frames++ == 0 ? cost : (m_cost * 7 + cost) / 8;
+
+    double load = (
+        std::chrono::duration<double>(m_cost) /
+        std::chrono::duration<double>(budget)
+    );
+
+    // Frames are only fast if the level above would not be slow, given it
+    // costs more by its number of pixels.
+    bool fits = (
+        m_level > 0 &&
+        load * pixels(m_level - 1) / pixels(m_level) <= HIGH_LOAD
+    );
+
+    m_slow = load > HIGH_LOAD ? m_slow + 1 : 0;
+    m_fast = load < LOW_LOAD && fits ? m_fast + 1 : 0;
+
+    std::size_t level = m_level;
+    if (m_slow >= LOWER_FRAMES && m_level + 1 < m_levels.size()) {
+        level++;
+        m_backoff[m_level] = std::min(m_backoff[m_level] + 1, MAX_BACKOFF);
+    }
+    else if (m_level > 0 && m_fast >= RAISE_FRAMES << m_backoff[m_level - 1]) {
+        level--;
+    }
+
+    if (level == m_level)
+        return false;
+
+    m_level = level;
+    m_frames = 0;
+    m_slow = 0;
+    m_fast = 0;
+    return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "util/Time.h"
+
+/**
+ * @brief Chooses the render quality from how long frames take to render, so
+ * the frame rate holds on machines too slow to render at full quality.
+ *
+ * Quality is a ladder of levels from best to cheapest. Frames taking most of
+ * their budget for a few frames in a row step down a level at once, while
+ * frames taking little of it step back up only after many frames.
+ *
+ * Stepping up is also held back so the quality settles rather than switching
+ * between two levels. The cost of the level above is predicted from its
+ * number of pixels, and it is not returned to if it would be slow. Each time
+ * a level is stepped down from, returning to it takes twice as many fast
+ * frames, covering costs such as antialiasing that are not predicted.
+ */
+class QualityController
+{
+public:
+
+    /**
+     * @brief A level of render quality.
+     */
+    struct Level
+    {
+        /// The resolution to render at relative to the window.
+        float scale;
+
+        /// The level of multisample antialiasing.
+        unsigned int antialiasing;
+    };
+
+    /**
+     * @brief Create a quality controller, starting at the best level.
+     *
+     * @param levels The levels of quality from best to cheapest.
+     */
+    QualityController(std::vector<Level> levels = {
+        {1.0f, 8}, {1.0f, 4}, {1.0f, 2}, {1.0f, 0}, {0.75f, 0}, {0.5f, 0}
+    });
+
+    /**
+     * @brief Record the time taken to render a frame.
+     *
+     * @param cost The time spent rendering the frame, including presenting
+     * it unless that only waited for the display.
+     * @param budget The time available for each frame.
+     * @return If the level of quality changed.
+     */
+    bool record(Time::Duration cost, Time::Duration budget);
+
+    /**
+     * @brief Get the current level of quality.
+     * @return The level of quality.
+     */
+    inline const Level &level() const {
+        return m_levels[m_level];
+    }
+
+private:
+
+    /// The fraction of the budget above which frames are too slow.
+    static const constexpr double HIGH_LOAD = 0.8;
+
+    /// The fraction of the budget below which frames are fast enough to raise
+    /// the quality.
+    static const constexpr double LOW_LOAD = 0.4;
+
+    /// The number of consecutive slow frames lowering the quality.
+    static const constexpr std::size_t LOWER_FRAMES = 8;
+
+    /// The number of consecutive fast frames raising the quality.
+    static const constexpr std::size_t RAISE_FRAMES = 120;
+
+    /// The most times the fast frames raising the quality to a level are
+    /// doubled for stepping down from it.
+    static const constexpr std::size_t MAX_BACKOFF = 6;
+
+    /**
+     * @brief Get the number of pixels rendered at a level relative to the
+     * window.
+     *
+     * @param level The index of the level.
+     * @return The fraction of the window's pixels rendered.
+     */
+    inline double pixels(std::size_t level) const {
+        return (double)m_levels[level].scale * m_levels[level].scale;
+    }
+
+    /// The levels of quality from best to cheapest.
+    std::vector<Level> m_levels;
+
+    /// The index of the current level.
+    std::size_t m_level;
+
+    /// The mean time taken to render frames at the current level.
+    Time::Duration m_cost;
+
+    /// The number of frames recorded at the current level.
+    std::size_t m_frames;
+
+    /// The number of consecutive slow frames.
+    std::size_t m_slow;
+
+    /// The number of consecutive fast frames.
+    std::size_t m_fast;
+
+    /// The number of times each level was stepped down from, up to the most
+    /// backoff.
+    std::vector<std::size_t> m_backoff;
+};
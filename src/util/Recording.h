@@ -0,0 +1,449 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/Messenger.h"
+#include "util/StopCondition.h"
+#include "util/Time.h"
+#include "util/TypeList.h"
+
+/**
+ * @brief Recording and replaying of the messages published to a messenger.
+ *
+ * A recording is a binary file beginning with a header:
+ *
+ * - 8 bytes magic "RUNESREC"
+ * - uint32 version
+ * - uint32 number of topics
+ * - uint32 size of each topic
+ *
+ * followed by a record for each published batch of messages:
+ *
+ * - uint64 nanoseconds since the recording started
+ * - uint32 topic
+ * - uint32 number of messages
+ * - the bytes of each message
+ *
+ * Integers are in the byte order of the recording machine. Messages are
+ * copied byte for byte, so every topic must be trivially copyable.
+ */
+namespace Recording {
+
+/// The first bytes of every recording.
+static const constexpr char MAGIC[8] = {'R', 'U', 'N', 'E', 'S', 'R', 'E', 'C'};
+
+/// The version of the recording format.
+static const constexpr std::uint32_t VERSION = 1;
+
+/**
+ * @brief The sizes of each topic in a type list.
+ */
+template<typename Topics, std::size_t... Topic>
+constexpr std::array<std::uint32_t, TypeList::Size<Topics>> sizes(
+    std::index_sequence<Topic...>
+) {
+    return {(std::uint32_t)sizeof(TypeList::Get<Topics, Topic>)...};
+}
+
+/**
+ * @brief Records every message published to a messenger into a file.
+ *
+ * Recording starts on construction and stops on destruction. Messages are
+ * copied into a buffer as they are published, and written to the file by a
+ * thread of the recorder, so publishing never waits on the disk.
+ *
+ * @tparam Topics A type list of the types of each message.
+ */
+template<typename Topics>
+class Recorder
+{
+public:
+
+    static_assert(
+        TypeList::TriviallyCopyable<Topics>,
+        "Recorded messages must be trivially copyable."
+    );
+
+    /**
+     * @brief Start recording the messages of a messenger.
+     *
+     * @param messenger The messenger to record.
+     * @param path The path of the file to write the recording to.
+     */
+    Recorder(Messenger<Topics> &messenger, const std::string &path);
+
+    /**
+     * @brief Stop recording, write the remaining messages and close the file.
+     */
+    ~Recorder();
+
+private:
+
+    /// How often buffered records are written to the file.
+    static const constexpr Time::Duration FLUSH_INTERVAL =
+        std::chrono::milliseconds(100);
+
+    /// The number of buffered bytes at which they are written immediately.
+    static const constexpr std::size_t FLUSH_SIZE = 64 * 1024;
+
+    /**
+     * @brief The buffered records, shared with the messenger observer so it
+     * may outlive the recorder.
+     */
+    struct State
+    {
+        /// Mutex protecting the buffer.
+        std::mutex mutex;
+
+        /// Condition notified when the buffer is large enough to write.
+        std::condition_variable_any condition;
+
+        /// Records not yet written to the file.
+        std::vector<char> buffer;
+
+        /// If the recording has stopped.
+        bool closed = false;
+
+        /// When the recording started.
+        Time::Timestamp start;
+    };
+
+    /**
+     * @brief Thread writing the buffered records to the file.
+     *
+     * @param stop A stop token to stop the writer thread.
+     */
+    void writer(std::stop_token stop);
+
+    /// The file being written to, only used by the writer once started.
+    std::ofstream m_file;
+
+    /// The state of the recording.
+    std::shared_ptr<State> m_state;
+
+    /// Thread writing to the file.
+    std::jthread m_writer;
+};
+
+/**
+ * @brief Replays the messages of a recording by publishing them to a
+ * messenger.
+ *
+ * @tparam Topics A type list of the types of each message.
+ */
+template<typename Topics>
+class Replayer
+{
+public:
+
+    /**
+     * @brief How quickly to publish the recorded messages.
+     */
+    enum class Speed
+    {
+        /// Publish with the same timing as they were recorded.
+        ORIGINAL,
+
+        /// Publish as fast as possible.
+        MAXIMUM
+    };
+
+    /**
+     * @brief Load a recording into memory.
+     *
+     * @param path The path of the recording.
+     */
+    Replayer(const std::string &path);
+
+    /**
+     * @brief Publish the recorded messages.
+     *
+     * @param messenger The messenger to publish to.
+     * @param speed How quickly to publish the messages.
+     * @param stop A stop token to stop replaying early.
+     */
+    void replay(
+        Messenger<Topics> &messenger,
+        Speed speed = Speed::ORIGINAL,
+        std::stop_token stop = {}
+    );
+
+    /**
+     * @brief Get the number of recorded batches of messages.
+     * @return The number of recorded batches.
+     */
+    inline std::size_t size() const {
+        return m_records.size();
+    }
+
+private:
+
+    /**
+     * @brief A recorded batch of messages.
+     */
+    struct Record
+    {
+        /// When the batch was published, relative to the recording start.
+        Time::Duration time;
+
+        /// The topic of the messages.
+        std::size_t topic;
+
+        /// The number of messages.
+        std::size_t count;
+
+        /// Offset of the first message in m_data.
+        std::size_t offset;
+    };
+
+    /**
+     * @brief Publish a recorded batch of a topic.
+     *
+     * @tparam Topic The topic of the batch.
+     * @param messenger The messenger to publish to.
+     * @param data Pointer to the bytes of the messages.
+     * @param count The number of messages.
+     */
+    template<std::size_t Topic>
+    static void publish(
+        Messenger<Topics> &messenger,
+        const char *data,
+        std::size_t count
+    );
+
+    /**
+     * @brief A function that publishes a recorded batch of one topic.
+     */
+    using Publisher = void(*)(Messenger<Topics> &, const char*, std::size_t);
+
+    /**
+     * @brief Get the publisher of every topic, indexed by topic.
+     */
+    template<std::size_t... Topic>
+    static constexpr std::array<Publisher, TypeList::Size<Topics>> publishers(
+        std::index_sequence<Topic...>
+    ) {
+        return {&Replayer::publish<Topic>...};
+    }
+
+    /// The recorded batches in publishing order.
+    std::vector<Record> m_records;
+
+    /// The bytes of every recorded message.
+    std::vector<char> m_data;
+};
+
+template<typename Topics>
+Recorder<Topics>::Recorder(Messenger<Topics> &messenger, const std::string &path)
+    : m_state(std::make_shared<State>())
+{
+    static const constexpr auto SIZES = sizes<Topics>(
+        std::make_index_sequence<TypeList::Size<Topics>>()
+    );
+
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        throw std::runtime_error("Failed to open recording " + path + ".");
+
+    std::uint32_t topics = TypeList::Size<Topics>;
+    m_file.write(MAGIC, sizeof(MAGIC));
+    m_file.write((const char*)&VERSION, sizeof(VERSION));
+    m_file.write((const char*)&topics, sizeof(topics));
+    m_file.write((const char*)SIZES.data(), sizeof(SIZES));
+    m_state->start = Time::now();
+
+    m_writer = std::jthread([this](std::stop_token stop) { writer(stop); });
+
+    messenger.observe(
+        [state = m_state](
+            std::size_t topic,
+            const void *messages,
+            std::size_t count,
+            Time::Timestamp published
+        ) {
+            // Called under the messenger's lock, so only copy the record.
+            std::scoped_lock lock(state->mutex);
+            if (state->closed)
+                return;
+
+            std::uint64_t time = std::chrono::nanoseconds(
+                published - state->start
+            ).count();
+            std::uint32_t index = (std::uint32_t)topic;
+            std::uint32_t size = (std::uint32_t)count;
+
+            auto append = [&](const void *data, std::size_t bytes) {
+                const char *begin = (const char*)data;
+                state->buffer.insert(state->buffer.end(), begin, begin + bytes);
+            };
+
+            append(&time, sizeof(time));
+            append(&index, sizeof(index));
+            append(&size, sizeof(size));
+            append(messages, count * SIZES[topic]);
+
+            if (state->buffer.size() >= FLUSH_SIZE)
+                state->condition.notify_one();
+        }
+    );
+}
+
+template<typename Topics>
+Recorder<Topics>::~Recorder()
+{
+    {
+        std::scoped_lock lock(m_state->mutex);
+        m_state->closed = true;
+    }
+
+    // Writes whatever is left before closing the file.
+    m_writer.request_stop();
+    m_writer.join();
+    m_file.close();
+}
+
+template<typename Topics>
+void Recorder<Topics>::writer(std::stop_token stop)
+{
+    std::vector<char> records;
+
+    while (true) {
+        {
+            std::unique_lock lock(m_state->mutex);
+            m_state->condition.wait_for(lock, stop, FLUSH_INTERVAL, [&]{
+                return m_state->buffer.size() >= FLUSH_SIZE;
+            });
+
+            records.swap(m_state->buffer);
+        }
+
+        m_file.write(records.data(), records.size());
+        m_file.flush();
+        records.clear();
+
+        if (stop.stop_requested())
+            return;
+    }
+}
+
+template<typename Topics>
+Replayer<Topics>::Replayer(const std::string &path)
+{
+    static const constexpr auto SIZES = sizes<Topics>(
+        std::make_index_sequence<TypeList::Size<Topics>>()
+    );
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open recording " + path + ".");
+
+    char magic[sizeof(MAGIC)];
+    std::uint32_t version;
+    std::uint32_t topics;
+    std::array<std::uint32_t, TypeList::Size<Topics>> recorded_sizes;
+
+    file.read(magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&topics, sizeof(topics));
+
+    if (
+        !file ||
+        std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        version != VERSION ||
+        topics != TypeList::Size<Topics>
+    ) {
+        throw std::runtime_error("Recording " + path + " is incompatible.");
+    }
+
+    file.read((char*)recorded_sizes.data(), sizeof(recorded_sizes));
+    if (!file || recorded_sizes != SIZES)
+        throw std::runtime_error("Recording " + path + " is incompatible.");
+
+    while (true) {
+        std::uint64_t time;
+        std::uint32_t topic;
+        std::uint32_t count;
+
+        if (!file.read((char*)&time, sizeof(time)))
+            break;
+
+        file.read((char*)&topic, sizeof(topic));
+        file.read((char*)&count, sizeof(count));
+        if (!file || topic >= TypeList::Size<Topics>)
+            throw std::runtime_error("Recording " + path + " is corrupt.");
+
+        std::size_t offset = m_data.size();
+        std::size_t bytes = (std::size_t)count * SIZES[topic];
+        m_data.resize(offset + bytes);
+
+        if (!file.read(m_data.data() + offset, bytes))
+            throw std::runtime_error("Recording " + path + " is truncated.");
+
+        m_records.push_back(Record{
+            std::chrono::nanoseconds(time),
+            topic,
+            count,
+            offset
+        });
+    }
+}
+
+template<typename Topics>
+void Replayer<Topics>::replay(
+    Messenger<Topics> &messenger,
+    Speed speed,
+    std::stop_token stop
+) {
+    static const constexpr auto PUBLISHERS = publishers(
+        std::make_index_sequence<TypeList::Size<Topics>>()
+    );
+
+    StopCondition condition(stop);
+    Time::Timestamp start = Time::now();
+
+    for (const Record &record : m_records) {
+        if (speed == Speed::ORIGINAL)
+            condition.wait_until(start + record.time);
+
+        if (condition)
+            return;
+
+        PUBLISHERS[record.topic](
+            messenger,
+            m_data.data() + record.offset,
+            record.count
+        );
+    }
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+void Replayer<Topics>::publish(
+    Messenger<Topics> &messenger,
+    const char *data,
+    std::size_t count
+) {
+    using Message = TypeList::Get<Topics, Topic>;
+
+    std::vector<Message> messages(count);
+    std::memcpy(messages.data(), data, count * sizeof(Message));
+
+    // Keep the batching of the recording.
+    if (count == 1)
+        messenger.template publish<Topic>(std::move(messages.front()));
+    else
+        messenger.template publish_batch<Topic>(messages);
+}
+
+} // namespace Recording
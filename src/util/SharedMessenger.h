@@ -0,0 +1,793 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "util/Time.h"
+#include "util/TypeList.h"
+
+/**
+ * @brief A messenger between processes on the same host, over a POSIX shared
+ * memory ring buffer.
+ *
+ * Any number of processes may publish to a shared messenger, and one process
+ * should subscribe to it. For messages in both directions use two shared
+ * messengers with different names.
+ *
+ * Messages are copied byte for byte between processes, so every topic must be
+ * trivially copyable and both processes must be built with the same topics.
+ *
+ * Subscribers are called back in publishing order on a single reader thread,
+ * which polls the ring while busy so messages are delivered within
+ * microseconds, and once idle for a while sleeps on a futex in the shared
+ * memory until a publisher wakes it. Callbacks may subscribe and unsubscribe.
+ *
+ * Publishers wait a short while for space when the ring is full, then drop the
+ * message, so a stalled reader never blocks a publishing process for long.
+ * Dropped messages are counted in the statistics of their topic.
+ *
+ * @tparam Topics A type list of the types of each message.
+ */
+template<typename Topics>
+class SharedMessenger
+{
+public:
+
+    static_assert(
+        TypeList::TriviallyCopyable<Topics>,
+        "Shared messages must be trivially copyable."
+    );
+
+    static_assert(
+        std::atomic<std::uint64_t>::is_always_lock_free,
+        "Shared messages require lock free atomics."
+    );
+
+    /**
+     * @brief Create or open a shared messenger.
+     *
+     * @param name The name of the shared memory object, beginning with '/'.
+     * @param create If the shared memory should be created, otherwise an
+     * existing one is opened, waiting for its creator to finish initialising
+     * it. The creating messenger removes the name when destroyed.
+     * @param stop A stop source to use if provided.
+     * @param capacity The number of messages the ring holds, a power of two.
+     * Ignored when opening.
+     */
+    SharedMessenger(
+        const std::string &name,
+        bool create,
+        std::optional<std::stop_source> stop = std::nullopt,
+        std::size_t capacity = 1024
+    );
+
+    /**
+     * @brief Stops the reader and unmaps the shared memory.
+     */
+    ~SharedMessenger();
+
+    /**
+     * @brief Subscribe to a topic. Starts reading messages from the ring.
+     *
+     * @tparam Topic The topic to subscribe to.
+     * @param function The function to callback on to receive data.
+     *
+     * @returns An integer identifier of the subscription.
+     */
+    template<std::size_t Topic>
+    std::size_t subscribe(
+        std::function<void(const TypeList::Get<Topics, Topic> &)> &&function
+    );
+
+    /**
+     * @brief Remove a subscription to a topic.
+     *
+     * Waits for a message being called back to finish, so once this returns
+     * the subscriber is not called back, unless called from a callback, when
+     * the subscriber may still receive the message being called back.
+     *
+     * @tparam Topic The topic subscribed to.
+     * @param id The identifier returned when subscribing.
+     */
+    template<std::size_t Topic>
+    void unsubscribe(std::size_t id);
+
+    /**
+     * @brief Publish data to a topic. Waits up to FULL_TIMEOUT for space
+     * while the ring is full, then drops the message.
+     *
+     * @tparam Topic The topic to publish data to.
+     * @param data The data to publish to all subscribers.
+     */
+    template<std::size_t Topic>
+    void publish(TypeList::Get<Topics, Topic> &&data);
+
+    /**
+     * @brief Publish data to a topic.
+     *
+     * @tparam Topic The topic to publish data to.
+     * @param args The data to publish to all subscribers.
+     */
+    template<std::size_t Topic, typename... Args>
+    inline void publish(Args&&... args) {
+        publish<Topic>(
+            TypeList::Get<Topics, Topic>(std::forward<Args>(args)...)
+        );
+    }
+
+    /**
+     * @brief Publish a message of a topic only known at runtime, such as one
+     * observed on a Messenger.
+     *
+     * @param topic The index of the topic to publish to.
+     * @param message Pointer to the message, of the type of the topic.
+     */
+    void publish(std::size_t topic, const void *message);
+
+    /**
+     * @brief Publish a message of a topic only known at runtime without
+     * waiting, dropping it at once if the ring is full. Suits callers that
+     * must not block, such as observers of a Messenger.
+     *
+     * @param topic The index of the topic to publish to.
+     * @param message Pointer to the message, of the type of the topic.
+     * @return If the message was published rather than dropped.
+     */
+    bool try_publish(std::size_t topic, const void *message);
+
+    /**
+     * @brief Counters of the messages on a single topic in this process.
+     */
+    struct TopicStatistics
+    {
+        /// The number of messages published to the ring.
+        std::uint64_t published;
+
+        /// The number of messages read from the ring and called back.
+        std::uint64_t dispatched;
+
+        /// The number of messages dropped as the ring was full.
+        std::uint64_t dropped;
+    };
+
+    /**
+     * @brief The statistics of every topic, indexed by topic.
+     */
+    using Statistics = std::array<TopicStatistics, TypeList::Size<Topics>>;
+
+    /**
+     * @brief Get a snapshot of the statistics of every topic.
+     * @return The statistics of each topic.
+     */
+    Statistics statistics() const;
+
+    /// How long publishing waits for space in a full ring.
+    static const constexpr Time::Duration FULL_TIMEOUT = 1ms;
+
+    /// How long opening waits for the creator to initialise the ring.
+    static const constexpr Time::Duration OPEN_TIMEOUT = 1s;
+
+private:
+
+    /// Identifies initialised shared memory of this layout.
+    static const constexpr std::uint64_t MAGIC = 0x52554e45534d5332;
+
+    /// The size of a cache line, to keep the producer and consumer apart.
+    static const constexpr std::size_t CACHE_LINE = 64;
+
+    /**
+     * @brief A single message in the ring.
+     */
+    struct Slot
+    {
+        /// Position of the slot in the ring sequence, used to claim it.
+        std::atomic<std::uint64_t> sequence;
+
+        /// The topic of the message.
+        std::uint64_t topic;
+
+        /// The message data.
+        alignas(TypeList::MaxAlign<Topics>)
+        unsigned char data[TypeList::MaxSize<Topics>];
+    };
+
+    /**
+     * @brief The header at the start of the shared memory.
+     */
+    struct Header
+    {
+        /// Set once the ring is initialised, last, so openers know it is
+        /// ready.
+        std::atomic<std::uint64_t> magic;
+
+        /// The number of topics, checked when opening.
+        std::uint64_t topics;
+
+        /// The size of each slot, checked when opening.
+        std::uint64_t slot_size;
+
+        /// The number of slots in the ring.
+        std::uint64_t capacity;
+
+        /// The next position to publish to.
+        alignas(CACHE_LINE) std::atomic<std::uint64_t> head;
+
+        /// The next position to read from.
+        alignas(CACHE_LINE) std::atomic<std::uint64_t> tail;
+
+        /// Futex word the reader sleeps on, changed to wake it.
+        alignas(CACHE_LINE) std::atomic<std::uint32_t> signal;
+
+        /// Raised while the reader may be sleeping, so publishers only make
+        /// a system call to wake it when needed.
+        std::atomic<std::uint32_t> sleeping;
+    };
+
+    static_assert(
+        sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+        "Futex words must be plain 32 bit integers."
+    );
+
+    /**
+     * @brief A subscriber to a topic, given a pointer to the message.
+     */
+    struct Subscription
+    {
+        /// The identifier returned when subscribing.
+        std::size_t id;
+
+        /// The function called back.
+        std::function<void(const void*)> function;
+    };
+
+    /**
+     * @brief The subscribers of each topic.
+     */
+    using Callbacks = std::array<
+        std::vector<Subscription>,
+        TypeList::Size<Topics>
+    >;
+
+    /**
+     * @brief The counters of a topic.
+     */
+    struct Counters
+    {
+        /// The number of messages published to the ring.
+        std::atomic<std::uint64_t> published {0};
+
+        /// The number of messages read from the ring and called back.
+        std::atomic<std::uint64_t> dispatched {0};
+
+        /// The number of messages dropped as the ring was full.
+        std::atomic<std::uint64_t> dropped {0};
+    };
+
+    /**
+     * @brief Thread reading messages from the ring and calling back.
+     *
+     * @param stop A stop token to stop the reader thread.
+     */
+    void reader(std::stop_token stop);
+
+    /**
+     * @brief Claim a slot and copy a message into it.
+     *
+     * @param topic The topic of the message.
+     * @param message Pointer to the message.
+     * @param size The size of the message.
+     * @param timeout How long to wait for space while the ring is full.
+     * @return If the message was published rather than dropped.
+     */
+    bool write(
+        std::uint64_t topic,
+        const void *message,
+        std::size_t size,
+        Time::Duration timeout
+    );
+
+    /**
+     * @brief Wake the reader if it is sleeping.
+     */
+    void wake();
+
+    /**
+     * @brief The sizes of each topic.
+     */
+    template<std::size_t... Topic>
+    static constexpr std::array<std::size_t, sizeof...(Topic)> sizes(
+        std::index_sequence<Topic...>
+    ) {
+        return {sizeof(TypeList::Get<Topics, Topic>)...};
+    }
+
+    /**
+     * @brief Get a slot in the ring.
+     *
+     * @param position The position in the ring sequence.
+     * @return The slot at the position.
+     */
+    inline Slot &slot(std::uint64_t position) {
+        return m_slots[position & (m_header->capacity - 1)];
+    }
+
+    /// The name of the shared memory object.
+    std::string m_name;
+
+    /// If this messenger created the shared memory object.
+    bool m_owner;
+
+    /// The size of the mapped memory.
+    std::size_t m_size;
+
+    /// The shared header.
+    Header *m_header;
+
+    /// The shared slots, following the header.
+    Slot *m_slots;
+
+    /// Mutex protecting the callbacks and the state of dispatching.
+    std::mutex m_mutex;
+
+    /// Callbacks of each topic, replaced rather than changed so the reader
+    /// can call back without holding the mutex.
+    std::shared_ptr<const Callbacks> m_callbacks;
+
+    /// The identifier of the next subscription.
+    std::size_t m_next_id;
+
+    /// If the reader is calling back a message.
+    bool m_dispatching;
+
+    /// The number of messages the reader has finished calling back.
+    std::uint64_t m_dispatches;
+
+    /// Notified when the reader finishes calling back a message.
+    std::condition_variable m_dispatched;
+
+    /// The counters of each topic.
+    std::array<Counters, TypeList::Size<Topics>> m_counters;
+
+    /// Source for stopping the reader.
+    std::stop_source m_stop_source;
+
+    /// Thread reading messages, started by the first subscription.
+    std::jthread m_reader;
+};
+
+template<typename Topics>
+SharedMessenger<Topics>::SharedMessenger(
+    const std::string &name,
+    bool create,
+    std::optional<std::stop_source> stop,
+    std::size_t capacity
+)
+    : m_name(name)
+    , m_owner(create)
+    , m_size(0)
+    , m_header(nullptr)
+    , m_slots(nullptr)
+    , m_callbacks(std::make_shared<const Callbacks>())
+    , m_next_id(0)
+    , m_dispatching(false)
+    , m_dispatches(0)
+{
+    if (stop) {
+        m_stop_source = stop.value();
+    }
+
+    if (create && (capacity == 0 || (capacity & (capacity - 1)) != 0))
+        throw std::invalid_argument("Capacity must be a power of two.");
+
+    int flags = create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR;
+    int fd = shm_open(name.c_str(), flags, 0600);
+    if (fd == -1)
+        throw std::runtime_error("Failed to open shared memory " + name + ".");
+
+    // The creator sizes the memory then initialises it, so an opener may see
+    // it before either has happened.
+    Time::Timestamp deadline = Time::now() + OPEN_TIMEOUT;
+
+    if (create) {
+        m_size = sizeof(Header) + capacity * sizeof(Slot);
+        if (ftruncate(fd, (off_t)m_size) == -1) {
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("Failed to size shared memory.");
+        }
+    }
+    else {
+        struct stat status;
+        while (true) {
+            if (fstat(fd, &status) == -1) {
+                close(fd);
+                throw std::runtime_error("Shared memory " + name + " is invalid.");
+            }
+
+            if ((std::size_t)status.st_size >= sizeof(Header))
+                break;
+
+            if (Time::now() > deadline) {
+                close(fd);
+                throw std::runtime_error("Shared memory " + name + " is not ready.");
+            }
+
+            std::this_thread::sleep_for(1ms);
+        }
+        m_size = (std::size_t)status.st_size;
+    }
+
+    void *memory = mmap(
+        nullptr,
+        m_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd,
+        0
+    );
+    close(fd);
+
+    if (memory == MAP_FAILED) {
+        if (create)
+            shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to map shared memory " + name + ".");
+    }
+
+    m_header = static_cast<Header*>(memory);
+    m_slots = reinterpret_cast<Slot*>(static_cast<char*>(memory) + sizeof(Header));
+
+    if (create) {
+        // Freshly truncated memory is zeroed, so only the fields need setting
+        // before publishing the magic number.
+        m_header->topics = TypeList::Size<Topics>;
+        m_header->slot_size = sizeof(Slot);
+        m_header->capacity = capacity;
+        m_header->head.store(0, std::memory_order_relaxed);
+        m_header->tail.store(0, std::memory_order_relaxed);
+        m_header->signal.store(0, std::memory_order_relaxed);
+        m_header->sleeping.store(0, std::memory_order_relaxed);
+
+        for (std::size_t i = 0; i < capacity; i++)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+        m_header->magic.store(MAGIC, std::memory_order_release);
+        return;
+    }
+
+    // Wait for the creator to publish the magic number, which may also be a
+    // different layout's.
+    std::uint64_t magic = m_header->magic.load(std::memory_order_acquire);
+    while (magic == 0 && Time::now() <= deadline) {
+        std::this_thread::sleep_for(1ms);
+        magic = m_header->magic.load(std::memory_order_acquire);
+    }
+
+    if (magic == 0) {
+        munmap(memory, m_size);
+        throw std::runtime_error("Shared memory " + name + " is not ready.");
+    }
+
+    if (
+        magic != MAGIC ||
+        m_header->topics != TypeList::Size<Topics> ||
+        m_header->slot_size != sizeof(Slot) ||
+        m_size < sizeof(Header) + m_header->capacity * sizeof(Slot)
+    ) {
+        munmap(memory, m_size);
+        throw std::runtime_error("Shared memory " + name + " is incompatible.");
+    }
+}
+
+template<typename Topics>
+SharedMessenger<Topics>::~SharedMessenger()
+{
+    m_stop_source.request_stop();
+    if (m_reader.joinable())
+        m_reader.join();
+
+    munmap(m_header, m_size);
+
+    if (m_owner)
+        shm_unlink(m_name.c_str());
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+std::size_t SharedMessenger<Topics>::subscribe(
+    std::function<void(const TypeList::Get<Topics, Topic> &)> &&function
+) {
+    using Message = TypeList::Get<Topics, Topic>;
+
+    std::scoped_lock lock(m_mutex);
+
+    auto callbacks = std::make_shared<Callbacks>(*m_callbacks);
+    std::get<Topic>(*callbacks).push_back({
+        m_next_id,
+        [function = std::move(function)](const void *message) {
+            // The slot data may not be aligned for every type, so copy out.
+            std::array<unsigned char, sizeof(Message)> bytes;
+            std::memcpy(bytes.data(), message, sizeof(Message));
+            function(std::bit_cast<Message>(bytes));
+        }
+    });
+    m_callbacks = std::move(callbacks);
+
+    if (!m_reader.joinable()) {
+        m_reader = std::jthread(
+            &SharedMessenger::reader,
+            this,
+            m_stop_source.get_token()
+        );
+    }
+
+    return m_next_id++;
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+void SharedMessenger<Topics>::unsubscribe(std::size_t id)
+{
+    std::unique_lock lock(m_mutex);
+
+    auto callbacks = std::make_shared<Callbacks>(*m_callbacks);
+    std::erase_if(
+        std::get<Topic>(*callbacks),
+        [id](const Subscription &s) { return s.id == id; }
+    );
+    m_callbacks = std::move(callbacks);
+
+    // The reader may be calling back with the old callbacks, so wait for it
+    // to finish the message, unless this is a callback on the reader.
+    if (std::this_thread::get_id() == m_reader.get_id() || !m_dispatching)
+        return;
+
+    std::uint64_t dispatches = m_dispatches;
+    m_dispatched.wait(lock, [&]{
+        return !m_dispatching || m_dispatches != dispatches;
+    });
+}
+
+template<typename Topics>
+template<std::size_t Topic>
+void SharedMessenger<Topics>::publish(TypeList::Get<Topics, Topic> &&message)
+{
+    write(Topic, &message, sizeof(message), FULL_TIMEOUT);
+}
+
+template<typename Topics>
+void SharedMessenger<Topics>::publish(std::size_t topic, const void *message)
+{
+    static const constexpr auto SIZES = sizes(
+        std::make_index_sequence<TypeList::Size<Topics>>()
+    );
+
+    if (topic < TypeList::Size<Topics>)
+        write(topic, message, SIZES[topic], FULL_TIMEOUT);
+}
+
+template<typename Topics>
+bool SharedMessenger<Topics>::try_publish(
+    std::size_t topic,
+    const void *message
+) {
+    static const constexpr auto SIZES = sizes(
+        std::make_index_sequence<TypeList::Size<Topics>>()
+    );
+
+    if (topic >= TypeList::Size<Topics>)
+        return false;
+
+    return write(topic, message, SIZES[topic], Time::Duration::zero());
+}
+
+template<typename Topics>
+typename SharedMessenger<Topics>::Statistics
+SharedMessenger<Topics>::statistics() const
+{
+    Statistics statistics;
+    for (std::size_t topic = 0; topic < statistics.size(); topic++) {
+        const auto &counters = m_counters[topic];
+        statistics[topic] = TopicStatistics{
+            counters.published.load(std::memory_order_relaxed),
+            counters.dispatched.load(std::memory_order_relaxed),
+            counters.dropped.load(std::memory_order_relaxed)
+        };
+    }
+
+    return statistics;
+}
+
+template<typename Topics>
+bool SharedMessenger<Topics>::write(
+    std::uint64_t topic,
+    const void *message,
+    std::size_t size,
+    Time::Duration timeout
+) {
+    std::stop_token stop = m_stop_source.get_token();
+    std::optional<Time::Timestamp> deadline;
+    std::uint64_t position = m_header->head.load(std::memory_order_relaxed);
+
+    // Claim a slot, bounded multi producer queue by sequence numbers.
+    while (!stop.stop_requested()) {
+        Slot &claim = slot(position);
+        std::uint64_t sequence = claim.sequence.load(std::memory_order_acquire);
+        std::int64_t difference = (std::int64_t)(sequence - position);
+
+        if (difference == 0) {
+            if (m_header->head.compare_exchange_weak(
+                position,
+                position + 1,
+                std::memory_order_relaxed
+            )) {
+                claim.topic = topic;
+                std::memcpy(claim.data, message, size);
+                claim.sequence.store(position + 1, std::memory_order_release);
+                wake();
+                m_counters[topic].published.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        else if (difference < 0) {
+            // The ring is full, wait a while for the reader.
+            Time::Timestamp now = Time::now();
+            if (!deadline)
+                deadline = now + timeout;
+
+            if (now >= *deadline)
+                break;
+
+            std::this_thread::yield();
+            position = m_header->head.load(std::memory_order_relaxed);
+        }
+        else {
+            position = m_header->head.load(std::memory_order_relaxed);
+        }
+    }
+
+    m_counters[topic].dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+template<typename Topics>
+void SharedMessenger<Topics>::wake()
+{
+    // Pairs with the fence in the reader, so either the reader sees the
+    // message before sleeping or this sees it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_header->sleeping.load(std::memory_order_relaxed) == 0)
+        return;
+
+    m_header->signal.fetch_add(1, std::memory_order_release);
+
+#ifdef __linux__
+    syscall(
+        SYS_futex,
+        reinterpret_cast<std::uint32_t*>(&m_header->signal),
+        FUTEX_WAKE,
+        1,
+        nullptr,
+        nullptr,
+        0
+    );
+#endif
+}
+
+template<typename Topics>
+void SharedMessenger<Topics>::reader(std::stop_token stop)
+{
+    using namespace std::chrono_literals;
+
+    // Polls spun and yielded before sleeping until woken.
+    static const constexpr std::size_t SPINS = 256;
+    static const constexpr std::size_t YIELDS = 4096;
+
+    // Stopping wakes the reader from sleep.
+    std::stop_callback on_stop(stop, [this]{
+        m_header->sleeping.store(1, std::memory_order_relaxed);
+        wake();
+    });
+
+    std::size_t idle = 0;
+    std::uint64_t position = m_header->tail.load(std::memory_order_relaxed);
+
+    while (!stop.stop_requested()) {
+        Slot &message = slot(position);
+        std::uint64_t sequence = message.sequence.load(std::memory_order_acquire);
+
+        if (sequence != position + 1) {
+            if (++idle < SPINS)
+                continue;
+            else if (idle < YIELDS) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            m_header->sleeping.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::uint32_t signal = m_header->signal.load(std::memory_order_acquire);
+
+            // A message published before sleeping was flagged is seen here,
+            // and one published after changes the signal and so the futex
+            // wait returns at once.
+            sequence = message.sequence.load(std::memory_order_acquire);
+            if (sequence != position + 1 && !stop.stop_requested()) {
+#ifdef __linux__
+                syscall(
+                    SYS_futex,
+                    reinterpret_cast<std::uint32_t*>(&m_header->signal),
+                    FUTEX_WAIT,
+                    signal,
+                    nullptr,
+                    nullptr,
+                    0
+                );
+#else
+                std::this_thread::sleep_for(50us);
+#endif
+            }
+
+            m_header->sleeping.store(0, std::memory_order_relaxed);
+            continue;
+        }
+
+        idle = 0;
+
+        // Callbacks are called without the lock, so may subscribe and
+        // unsubscribe.
+        if (message.topic < TypeList::Size<Topics>) {
+            std::shared_ptr<const Callbacks> callbacks;
+            {
+                std::scoped_lock lock(m_mutex);
+                callbacks = m_callbacks;
+                m_dispatching = true;
+            }
+
+            for (const auto &subscription : (*callbacks)[message.topic])
+                subscription.function(message.data);
+
+            {
+                std::scoped_lock lock(m_mutex);
+                m_dispatching = false;
+                ++m_dispatches;
+            }
+            m_dispatched.notify_all();
+
+            m_counters[message.topic].dispatched.fetch_add(
+                1,
+                std::memory_order_relaxed
+            );
+        }
+
+        // Release the slot for the lap after this one.
+        message.sequence.store(
+            position + m_header->capacity,
+            std::memory_order_release
+        );
+        m_header->tail.store(++position, std::memory_order_relaxed);
+    }
+}
@@ -61,3 +61,33 @@ std::unique_lock<std::mutex> StopCondition::wait_until(Time::Timestamp timestamp
 
     return lock;
 }
+
+void StopCondition::notify_one()
+{
+    // Taking the mutex ensures a waiter that has checked its predicate is
+    // waiting on the condition before it is notified.
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+    }
+
+    m_condition.notify_one();
+}
+
+void StopCondition::notify_all()
+{
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+    }
+
+    m_condition.notify_all();
+}
+
+void StopCondition::notify_all(const std::function<void(void)> &update)
+{
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        update();
+    }
+
+    m_condition.notify_all();
+}
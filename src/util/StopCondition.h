@@ -125,6 +125,35 @@ public:
         return wait_until(Time::now() + duration, stop_waiting);
     }
 
+    /**
+     * @brief Lock the stop condition mutex, to read state that the predicates
+     * of waiters depend on.
+     * 
+     * @return A lock on the stop condition mutex.
+     */
+    inline std::unique_lock<std::mutex> lock() {
+        return std::unique_lock<std::mutex>(m_mutex);
+    }
+
+    /**
+     * @brief Wake one waiter to check its predicate.
+     */
+    void notify_one();
+
+    /**
+     * @brief Wake all waiters to check their predicates.
+     */
+    void notify_all();
+
+    /**
+     * @brief Change the state that the predicates of waiters depend on, then
+     * wake all waiters to check them.
+     * 
+     * @param update A function changing the state, called with the stop
+     * condition mutex held.
+     */
+    void notify_all(const std::function<void(void)> &update);
+
 private:
 
     /// Signal to stop waiting permanently.
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+/**
+ * @brief A coroutine running a sequential flow, such as waiting for input then
+ * acting on it, without blocking a thread while it waits.
+ *
+ * The coroutine starts running as soon as it is called, until its first
+ * suspension. It is resumed by whatever it awaits, on that thread, and is
+ * destroyed with the task. A task must not be destroyed while its coroutine is
+ * being resumed on another thread.
+ */
+class Task
+{
+public:
+
+    /**
+     * @brief The promise of a task coroutine.
+     */
+    struct promise_type
+    {
+        inline Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        inline std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        inline std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        inline void return_void() noexcept {}
+
+        inline void unhandled_exception() noexcept {
+            exception = std::current_exception();
+        }
+
+        /// An exception that escaped the coroutine.
+        std::exception_ptr exception;
+    };
+
+    Task() = default;
+
+    /**
+     * @brief Take ownership of another task's coroutine.
+     * @param other The task to move from.
+     */
+    inline Task(Task &&other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+
+    /**
+     * @brief Destroy this task's coroutine and take ownership of another's.
+     * @param other The task to move from.
+     */
+    inline Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Destroys the coroutine.
+     */
+    inline ~Task() {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    /**
+     * @brief Check if the coroutine has finished.
+     * @return If the coroutine has returned or thrown.
+     */
+    inline bool done() const {
+        return !m_handle || m_handle.done();
+    }
+
+    /**
+     * @brief Rethrow an exception that escaped the coroutine, if any.
+     */
+    inline void rethrow() const {
+        if (m_handle && m_handle.promise().exception)
+            std::rethrow_exception(m_handle.promise().exception);
+    }
+
+private:
+
+    /**
+     * @brief Create a task owning a coroutine.
+     * @param handle The coroutine.
+     */
+    inline explicit Task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {}
+
+    /// The coroutine owned by the task.
+    std::coroutine_handle<promise_type> m_handle;
+};
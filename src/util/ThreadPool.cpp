@@ -0,0 +1,202 @@
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/// The pool the current thread belongs to, if any.
+static thread_local ThreadPool *t_pool = nullptr;
+
+/// The index of the current thread in its pool.
+static thread_local std::size_t t_index = 0;
+
+ThreadPool::ThreadPool(
+    std::size_t threads,
+    bool pin,
+    std::optional<std::stop_source> stop
+)
+    : m_queues()
+    , m_pending(0)
+    , m_sleeping(0)
+    , m_next(0)
+{
+    if (stop) {
+        m_stop_source = stop.value();
+    }
+
+    threads = std::max<std::size_t>(threads, 1);
+
+    for (std::size_t i = 0; i < threads; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    for (std::size_t i = 0; i < threads; i++) {
+        m_workers.push_back(
+            std::jthread(&ThreadPool::worker, this, m_stop_source.get_token(), i)
+        );
+
+#ifdef __linux__
+        if (pin) {
+            cpu_set_t cores;
+            CPU_ZERO(&cores);
+            CPU_SET(i % std::max(1u, std::thread::hardware_concurrency()), &cores);
+            pthread_setaffinity_np(
+                m_workers.back().native_handle(),
+                sizeof(cores),
+                &cores
+            );
+        }
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    m_stop_source.request_stop();
+    m_workers.clear();
+    cancel();
+}
+
+ThreadPool &ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(Job &&job)
+{
+    // Keep work submitted from a pool thread on that thread.
+    std::size_t index = t_pool == this
+        ? t_index
+        : m_next.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    {
+        std::scoped_lock lock(m_queues[index]->mutex);
+        m_queues[index]->jobs.push_front(std::move(job));
+    }
+
+    m_pending.fetch_add(1);
+
+    // The workers may have already exited and left the job behind.
+    if (m_stop_source.stop_requested()) {
+        cancel();
+        return;
+    }
+
+    // A worker that began sleeping before the job was counted is woken. Taking
+    // the mutex ensures it is waiting on the condition before notifying.
+    if (m_sleeping.load() > 0) {
+        std::scoped_lock lock(m_mutex);
+        m_condition.notify_one();
+    }
+}
+
+void ThreadPool::parallel_for(
+    std::size_t count,
+    const std::function<void(std::size_t)> &function
+) {
+    if (count == 0)
+        return;
+
+    // Shared with the jobs, which may start after this returns.
+    struct Progress
+    {
+        std::atomic<std::size_t> next {0};
+        std::atomic<std::size_t> done {0};
+    };
+
+    auto progress = std::make_shared<Progress>();
+
+    auto run = [progress, &function, count]() {
+        for (
+            std::size_t i = progress->next++;
+            i < count;
+            i = progress->next++
+        ) {
+            function(i);
+            if (++progress->done == count)
+                progress->done.notify_all();
+        }
+    };
+
+    std::size_t helpers = std::min(m_queues.size(), count - 1);
+    for (std::size_t i = 0; i < helpers; i++)
+        submit([run](std::stop_token) { run(); });
+
+    run();
+
+    for (
+        std::size_t done = progress->done.load();
+        done < count;
+        done = progress->done.load()
+    ) {
+        progress->done.wait(done);
+    }
+}
+
+bool ThreadPool::pop(std::size_t index, Job &job)
+{
+    Queue &queue = *m_queues[index];
+    std::scoped_lock lock(queue.mutex);
+
+    if (queue.jobs.empty())
+        return false;
+
+    job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t index, Job &job)
+{
+    for (std::size_t i = 1; i < m_queues.size(); i++) {
+        Queue &queue = *m_queues[(index + i) % m_queues.size()];
+        std::unique_lock lock(queue.mutex, std::try_to_lock);
+
+        if (!lock || queue.jobs.empty())
+            continue;
+
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::cancel()
+{
+    std::stop_token stop = m_stop_source.get_token();
+
+    for (std::size_t i = 0; i < m_queues.size(); i++) {
+        for (Job job; pop(i, job); job = nullptr) {
+            m_pending.fetch_sub(1);
+            job(stop);
+        }
+    }
+}
+
+void ThreadPool::worker(std::stop_token stop, std::size_t index)
+{
+    t_pool = this;
+    t_index = index;
+
+    while (!stop.stop_requested()) {
+        Job job;
+
+        if (pop(index, job) || steal(index, job)) {
+            m_pending.fetch_sub(1);
+            job(stop);
+            continue;
+        }
+
+        // A steal may fail on a contended queue, so only sleep when there is
+        // nothing left to take.
+        std::unique_lock lock(m_mutex);
+        ++m_sleeping;
+        m_condition.wait(lock, stop, [&]{ return m_pending.load() > 0; });
+        --m_sleeping;
+    }
+}
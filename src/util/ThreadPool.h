@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A work stealing pool of threads shared by the whole process, so work
+ * such as message dispatch and parallel search does not oversubscribe the
+ * cores with threads of its own.
+ *
+ * Each thread has its own queue of jobs. Jobs submitted from a pool thread go
+ * to the front of its own queue and are run most recent first, while idle
+ * threads steal the oldest jobs from the back of other queues. Jobs submitted
+ * from outside the pool are spread over the queues.
+ *
+ * Jobs should not block for long, as a blocked job holds its worker. Loops that
+ * spend their time blocked, such as the application state thread, the timer
+ * wheel, the shared messenger reader and the render thread that owns the GL
+ * context, keep threads of their own instead. On a pool with one thread any of
+ * them would stop every other job from running.
+ */
+class ThreadPool
+{
+public:
+
+    /**
+     * @brief A unit of work, given a token that is signalled when the pool is
+     * stopping so that long jobs can exit early.
+     */
+    using Job = std::function<void(std::stop_token)>;
+
+    /**
+     * @brief Start the threads of a pool.
+     *
+     * @param threads The number of threads, at least one.
+     * @param pin If each thread should be pinned to its own core, where
+     * supported.
+     * @param stop A stop source to use if provided.
+     */
+    ThreadPool(
+        std::size_t threads = std::thread::hardware_concurrency(),
+        bool pin = false,
+        std::optional<std::stop_source> stop = std::nullopt
+    );
+
+    /**
+     * @brief Stops and joins the threads. Jobs not yet started are cancelled.
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Get the pool shared by the whole process, with a thread for each
+     * core.
+     *
+     * @return The process wide thread pool.
+     */
+    static ThreadPool &global();
+
+    /**
+     * @brief Run a job on the pool. Once the pool has stopped the job is
+     * cancelled instead, run at once with a stopped token.
+     *
+     * @param job The job to run.
+     */
+    void submit(Job &&job);
+
+    /**
+     * @brief Run a function for every index in a range on the pool, returning
+     * once all have finished.
+     *
+     * The calling thread runs part of the range itself, so this may be called
+     * from within a job on the same pool.
+     *
+     * @param count The number of indices, from zero.
+     * @param function The function to call with each index.
+     */
+    void parallel_for(
+        std::size_t count,
+        const std::function<void(std::size_t)> &function
+    );
+
+    /**
+     * @brief Get the number of threads in the pool.
+     * @return The number of threads.
+     */
+    inline std::size_t size() const {
+        return m_queues.size();
+    }
+
+    /**
+     * @brief Get the stop token signalled when the pool stops.
+     * @return The stop token of the pool.
+     */
+    inline std::stop_token get_token() const {
+        return m_stop_source.get_token();
+    }
+
+private:
+
+    /**
+     * @brief The jobs queued on a single thread.
+     */
+    struct Queue
+    {
+        /// Mutex protecting the jobs.
+        std::mutex mutex;
+
+        /// Jobs, newest at the front.
+        std::deque<Job> jobs;
+    };
+
+    /**
+     * @brief Thread of each worker running jobs.
+     *
+     * @param stop A stop token to stop the worker thread.
+     * @param index The index of the worker's queue.
+     */
+    void worker(std::stop_token stop, std::size_t index);
+
+    /**
+     * @brief Take the newest job of a worker's own queue.
+     *
+     * @param index The index of the worker.
+     * @param job Set to the job taken.
+     * @return If a job was taken.
+     */
+    bool pop(std::size_t index, Job &job);
+
+    /**
+     * @brief Take the oldest job of another worker's queue.
+     *
+     * @param index The index of the stealing worker.
+     * @param job Set to the job taken.
+     * @return If a job was taken.
+     */
+    bool steal(std::size_t index, Job &job);
+
+    /**
+     * @brief Run every queued job with a stopped token, so that jobs waited
+     * on by others always finish once the pool stops.
+     */
+    void cancel();
+
+    /// The queue of each worker.
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    /// The number of jobs queued and not yet taken.
+    std::atomic<std::size_t> m_pending;
+
+    /// The number of workers waiting for jobs.
+    std::atomic<std::size_t> m_sleeping;
+
+    /// The next queue to submit to from outside the pool.
+    std::atomic<std::size_t> m_next;
+
+    /// Mutex protecting the condition variable.
+    std::mutex m_mutex;
+
+    /// Condition idle workers wait on.
+    std::condition_variable_any m_condition;
+
+    /// Source for stopping the pool.
+    std::stop_source m_stop_source;
+
+    /// The worker threads.
+    std::vector<std::jthread> m_workers;
+};
@@ -0,0 +1,255 @@
+#include "util/TimerWheel.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+TimerWheel::TimerWheel(
+    std::optional<std::stop_source> stop,
+    Time::Duration resolution
+)
+    : m_resolution(std::max<Time::Duration>(resolution, 1ns))
+    , m_start(Time::now())
+    , m_tick(0)
+    , m_size(0)
+    , m_wake(std::numeric_limits<std::uint64_t>::max())
+    , m_woken(false)
+    , m_stop_source(stop.value_or(std::stop_source()))
+    , m_condition(m_stop_source.get_token())
+{
+    m_thread = std::jthread(&TimerWheel::run, this, m_stop_source.get_token());
+}
+
+TimerWheel::~TimerWheel()
+{
+    m_stop_source.request_stop();
+    m_thread = std::jthread();
+}
+
+void TimerWheel::at(
+    Time::Timestamp when,
+    Callback callback,
+    std::stop_token cancel
+) {
+    bool wake;
+    {
+        auto lock = m_condition.lock();
+        wake = schedule(
+            Timer{when, 0, Time::Duration::zero(), std::move(callback), cancel}
+        );
+    }
+
+    if (wake)
+        m_condition.notify_one();
+}
+
+void TimerWheel::every(
+    Time::Duration period,
+    Callback callback,
+    std::stop_token cancel,
+    std::optional<Time::Timestamp> first
+) {
+    if (period <= Time::Duration::zero())
+        throw std::runtime_error("Timer period must be positive.");
+
+    bool wake;
+    {
+        auto lock = m_condition.lock();
+        wake = schedule(Timer{
+            first.value_or(Time::now() + period),
+            0,
+            period,
+            std::move(callback),
+            cancel
+        });
+    }
+
+    if (wake)
+        m_condition.notify_one();
+}
+
+std::size_t TimerWheel::size()
+{
+    auto lock = m_condition.lock();
+    return m_size;
+}
+
+void TimerWheel::run(std::stop_token stop)
+{
+    auto lock = m_condition.lock();
+    std::vector<Timer> due;
+
+    while (!stop.stop_requested()) {
+        advance((Time::now() - m_start) / m_resolution, due);
+
+        if (!due.empty()) {
+            lock.unlock();
+
+            for (Timer &timer : due) {
+                if (!timer.cancel.stop_requested())
+                    timer.callback();
+            }
+
+            lock.lock();
+
+            // Fixed rate timers are rescheduled from when they were due, then
+            // past any runs missed while callbacks were running.
+            Time::Timestamp now = Time::now();
+            for (Timer &timer : due) {
+                if (
+                    timer.period == Time::Duration::zero() ||
+                    timer.cancel.stop_requested()
+                ) {
+                    continue;
+                }
+
+                timer.due += timer.period;
+                if (timer.due <= now)
+                    timer.due += timer.period * ((now - timer.due) / timer.period + 1);
+
+                schedule(std::move(timer));
+            }
+
+            due.clear();
+            continue;
+        }
+
+        std::optional<std::uint64_t> wake = next_tick();
+        m_wake = wake.value_or(std::numeric_limits<std::uint64_t>::max());
+        m_woken = false;
+
+        // A timer scheduled before waiting begins raises m_woken, so is not
+        // missed while the lock is released.
+        lock.unlock();
+        if (wake)
+            lock = m_condition.wait_until(to_time(*wake), [&]{ return m_woken; });
+        else
+            lock = m_condition.wait([&]{ return m_woken; });
+    }
+}
+
+bool TimerWheel::schedule(Timer &&timer)
+{
+    // A timer due on a tick already advanced past runs on the next.
+    timer.tick = std::max(to_tick(timer.due), m_tick + 1);
+
+    bool wake = timer.tick < m_wake;
+    if (wake) {
+        m_wake = timer.tick;
+        m_woken = true;
+    }
+
+    insert(std::move(timer));
+    m_size++;
+    return wake;
+}
+
+void TimerWheel::insert(Timer &&timer)
+{
+    // The finest wheel on which the timer's tick and the current tick only
+    // differ in that wheel's slot, so the timer reaches the finest wheel
+    // exactly when the current tick reaches its slot.
+    std::vector<Timer> *slot = &m_overflow;
+    for (std::size_t wheel = 0; wheel < WHEELS; wheel++) {
+        std::size_t shift = BITS * (wheel + 1);
+        if ((timer.tick >> shift) == (m_tick >> shift)) {
+            slot = &m_wheels[wheel][(timer.tick >> (BITS * wheel)) & (SLOTS - 1)];
+            break;
+        }
+    }
+
+    // Timers scheduled and cancelled over and over, such as timeouts, would
+    // otherwise pile up in the slot.
+    compact(*slot);
+    slot->push_back(std::move(timer));
+}
+
+void TimerWheel::compact(std::vector<Timer> &slot)
+{
+    m_size -= std::erase_if(slot, [](const Timer &timer) {
+        return timer.cancel.stop_requested();
+    });
+}
+
+void TimerWheel::advance(std::uint64_t tick, std::vector<Timer> &due)
+{
+    while (m_tick < tick) {
+        // Ticks without timers or cascades are skipped.
+        std::optional<std::uint64_t> next = next_tick();
+        if (!next || *next > tick) {
+            m_tick = tick;
+            return;
+        }
+
+        m_tick = *next;
+
+        // Cascade coarsest first, as timers may cascade through several
+        // wheels on the same tick.
+        std::vector<Timer> cascade;
+
+        if ((m_tick & ((std::uint64_t(1) << (BITS * WHEELS)) - 1)) == 0)
+            std::swap(cascade, m_overflow);
+
+        for (std::size_t wheel = WHEELS - 1; wheel > 0; wheel--) {
+            if ((m_tick & ((std::uint64_t(1) << (BITS * wheel)) - 1)) != 0)
+                continue;
+
+            std::size_t slot = (m_tick >> (BITS * wheel)) & (SLOTS - 1);
+            compact(m_wheels[wheel][slot]);
+            std::move(
+                m_wheels[wheel][slot].begin(),
+                m_wheels[wheel][slot].end(),
+                std::back_inserter(cascade)
+            );
+            m_wheels[wheel][slot].clear();
+
+            for (Timer &timer : cascade)
+                insert(std::move(timer));
+            cascade.clear();
+        }
+
+        std::vector<Timer> &slot = m_wheels[0][m_tick & (SLOTS - 1)];
+        compact(slot);
+        m_size -= slot.size();
+        std::move(slot.begin(), slot.end(), std::back_inserter(due));
+        slot.clear();
+    }
+}
+
+std::optional<std::uint64_t> TimerWheel::next_tick() const
+{
+    if (m_size == 0)
+        return std::nullopt;
+
+    // The first occupied slot of the finest wheel before it wraps.
+    std::uint64_t boundary = (m_tick | (SLOTS - 1)) + 1;
+    for (std::uint64_t tick = m_tick + 1; tick < boundary; tick++) {
+        if (!m_wheels[0][tick & (SLOTS - 1)].empty())
+            return tick;
+    }
+
+    // Otherwise the next cascade of the finest occupied wheel.
+    std::size_t wheel = 1;
+    while (
+        wheel < WHEELS &&
+        std::all_of(
+            m_wheels[wheel].begin(),
+            m_wheels[wheel].end(),
+            [](const std::vector<Timer> &slot) { return slot.empty(); }
+        )
+    ) {
+        wheel++;
+    }
+
+    std::uint64_t span = std::uint64_t(1) << (BITS * wheel);
+    return (m_tick | (span - 1)) + 1;
+}
+
+std::uint64_t TimerWheel::to_tick(Time::Timestamp time) const
+{
+    if (time <= m_start)
+        return 0;
+
+    return (time - m_start + m_resolution - Time::Duration(1)) / m_resolution;
+}
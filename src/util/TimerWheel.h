@@ -0,0 +1,252 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "util/StopCondition.h"
+#include "util/Time.h"
+
+/**
+ * @brief Runs one shot and periodic timers on a single thread, using a
+ * hierarchical timing wheel.
+ *
+ * Time is divided into ticks of a fixed resolution. Timers due within the next
+ * SLOTS ticks are kept in the slot of their tick on the first wheel, and later
+ * timers in coarser wheels, each SLOTS times coarser than the last. As time
+ * passes timers cascade down to finer wheels, so scheduling and expiring a
+ * timer costs constant time regardless of how many timers exist.
+ *
+ * Callbacks run on the timer thread and should be short. Timers are never run
+ * early, and are run within one tick of being due while the thread is not
+ * busy running other callbacks.
+ *
+ * Cancelled timers are removed when the slot they are in is next added to or
+ * processed, so cancelling many timers does not leave them all held until
+ * they would have been due.
+ */
+class TimerWheel
+{
+public:
+
+    /**
+     * @brief A function called when a timer is due.
+     */
+    using Callback = std::function<void()>;
+
+    /**
+     * @brief Start the timer thread.
+     *
+     * @param stop A stop source to use if provided.
+     * @param resolution The length of each tick.
+     */
+    TimerWheel(
+        std::optional<std::stop_source> stop = std::nullopt,
+        Time::Duration resolution = 1ms
+    );
+
+    /**
+     * @brief Stops the timer thread. Timers not yet due are discarded.
+     */
+    ~TimerWheel();
+
+    /**
+     * @brief Run a callback once at a point in time.
+     *
+     * @param when The time to run the callback.
+     * @param callback The function to call.
+     * @param cancel A stop token cancelling the timer when stop is requested.
+     */
+    void at(
+        Time::Timestamp when,
+        Callback callback,
+        std::stop_token cancel = {}
+    );
+
+    /**
+     * @brief Run a callback once after a delay.
+     *
+     * @param delay The time to wait before running the callback.
+     * @param callback The function to call.
+     * @param cancel A stop token cancelling the timer when stop is requested.
+     */
+    inline void after(
+        Time::Duration delay,
+        Callback callback,
+        std::stop_token cancel = {}
+    ) {
+        at(Time::now() + delay, std::move(callback), cancel);
+    }
+
+    /**
+     * @brief Run a callback repeatedly at a fixed rate.
+     *
+     * Each run is scheduled a period after the previous run was due rather
+     * than when it ran, so the timer does not drift. Runs missed while the
+     * timer thread was busy are skipped rather than run in a burst.
+     *
+     * @param period The time between runs.
+     * @param callback The function to call.
+     * @param cancel A stop token cancelling the timer when stop is requested.
+     * @param first The time of the first run, a period from now by default.
+     */
+    void every(
+        Time::Duration period,
+        Callback callback,
+        std::stop_token cancel = {},
+        std::optional<Time::Timestamp> first = std::nullopt
+    );
+
+    /**
+     * @brief Get the length of each tick.
+     * @return The resolution of the timers.
+     */
+    inline Time::Duration resolution() const {
+        return m_resolution;
+    }
+
+    /**
+     * @brief Get the number of timers held, including cancelled timers not
+     * yet removed.
+     * @return The number of scheduled timers.
+     */
+    std::size_t size();
+
+private:
+
+    /// The number of bits of a tick indexing the slots of a wheel.
+    static const constexpr std::size_t BITS = 6;
+
+    /// The number of slots in each wheel.
+    static const constexpr std::size_t SLOTS = 1 << BITS;
+
+    /// The number of wheels.
+    static const constexpr std::size_t WHEELS = 4;
+
+    /**
+     * @brief A scheduled timer.
+     */
+    struct Timer
+    {
+        /// When the timer is due.
+        Time::Timestamp due;
+
+        /// The tick the timer is due on.
+        std::uint64_t tick;
+
+        /// The time between runs, or zero for a one shot timer.
+        Time::Duration period;
+
+        /// The function to call.
+        Callback callback;
+
+        /// Cancels the timer when stop is requested.
+        std::stop_token cancel;
+    };
+
+    /**
+     * @brief Thread advancing the wheels and running due timers.
+     *
+     * @param stop A stop token to stop the timer thread.
+     */
+    void run(std::stop_token stop);
+
+    /**
+     * @brief Schedule a timer for when it is due. Requires the lock of
+     * m_condition.
+     *
+     * @param timer The timer to schedule.
+     * @return If the timer is due before the timer thread would otherwise
+     * wake, so it needs notifying.
+     */
+    bool schedule(Timer &&timer);
+
+    /**
+     * @brief Add a timer to the slot of its tick on the finest wheel that
+     * reaches it. Requires the lock of m_condition.
+     *
+     * @param timer The timer to add.
+     */
+    void insert(Timer &&timer);
+
+    /**
+     * @brief Remove the cancelled timers of a slot. Requires the lock of
+     * m_condition.
+     *
+     * @param slot The slot to remove cancelled timers from.
+     */
+    void compact(std::vector<Timer> &slot);
+
+    /**
+     * @brief Advance the wheels to a tick, collecting the due timers.
+     * Requires the lock of m_condition.
+     *
+     * @param tick The tick to advance to.
+     * @param due Appended with the timers that are due.
+     */
+    void advance(std::uint64_t tick, std::vector<Timer> &due);
+
+    /**
+     * @brief Get the next tick that the wheels need to be advanced on,
+     * either to run a timer or cascade a coarser wheel. Requires the lock of
+     * m_condition.
+     *
+     * @return The next tick, or nothing if there are no timers.
+     */
+    std::optional<std::uint64_t> next_tick() const;
+
+    /**
+     * @brief Get the tick a time falls within.
+     *
+     * @param time The time to get the tick of.
+     * @return The tick, rounded up so timers do not run early.
+     */
+    std::uint64_t to_tick(Time::Timestamp time) const;
+
+    /**
+     * @brief Get the time a tick starts at.
+     *
+     * @param tick The tick.
+     * @return The time the tick starts.
+     */
+    inline Time::Timestamp to_time(std::uint64_t tick) const {
+        return m_start + m_resolution * tick;
+    }
+
+    /// The length of each tick.
+    Time::Duration m_resolution;
+
+    /// The time of tick zero.
+    Time::Timestamp m_start;
+
+    /// The current tick, all timers up to which have run.
+    std::uint64_t m_tick;
+
+    /// The slots of each wheel.
+    std::array<std::array<std::vector<Timer>, SLOTS>, WHEELS> m_wheels;
+
+    /// Timers further in the future than the coarsest wheel reaches.
+    std::vector<Timer> m_overflow;
+
+    /// The number of scheduled timers.
+    std::size_t m_size;
+
+    /// The tick the timer thread is sleeping until.
+    std::uint64_t m_wake;
+
+    /// If the timer thread was woken early by an earlier timer.
+    bool m_woken;
+
+    /// Source for stopping the timer thread.
+    std::stop_source m_stop_source;
+
+    /// Condition the timer thread sleeps on, whose mutex protects the wheels.
+    StopCondition m_condition;
+
+    /// The timer thread.
+    std::jthread m_thread;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <tuple>
+#include <type_traits>
 #include <variant>
 
 namespace TypeList {
@@ -104,19 +106,28 @@ struct _Get<List, 0> : public _Front<List> {};
 template<typename List, unsigned I>
 using Get = _Get<List, I>::type;
 
-template <typename List, typename Type, unsigned I>
-struct _Index {
-    static_assert(I < Size<List>);
-    static const constexpr std::size_t value = I;
-    using type = std::conditional_t<
-        std::is_same_v<Front<List>, Type>,
-        Type,
-        _Index<PopFront<List>, Type, I + 1>
-    >;
+// Get the index of a type in a type list.
+
+template <typename List, typename Type>
+struct _Index;
+
+template <typename Type, typename... Tail>
+struct _Index<TypeList<Type, Tail...>, Type> {
+    static const constexpr std::size_t value = 0;
 };
 
+template <typename Head, typename... Tail, typename Type>
+struct _Index<TypeList<Head, Tail...>, Type> {
+    static const constexpr std::size_t value = (
+        1 + _Index<TypeList<Tail...>, Type>::value
+    );
+};
+
+/**
+ * @brief Get the index of the first occurrence of a type in a type list.
+ */
 template <typename List, typename Type>
-using Index = _Index<List, Type, 0>::value;
+inline constexpr std::size_t Index = _Index<List, Type>::value;
 
 // Concatenate two type lists together.
 
@@ -142,19 +153,13 @@ using Concatenate = _Concatenate<Left, Right>::type;
 
 // Transform the types in a typelist with a meta function.
 
-template<template<typename T> class MetaFunction, typename Head, typename... Tail>
-struct _Transform
-{
-    using type = Concatenate<
-        TypeList<typename MetaFunction<Head>::type>,
-        typename _Transform<MetaFunction, Tail...>::type
-    >;
-};
+template<template<typename T> class MetaFunction, typename List>
+struct _Transform;
 
-template<template<typename T> class MetaFunction, typename Head>
-struct _Transform<MetaFunction, TypeList<Head>>
+template<template<typename T> class MetaFunction, typename... Types>
+struct _Transform<MetaFunction, TypeList<Types...>>
 {
-    using type = TypeList<typename MetaFunction<Head>::type>;
+    using type = TypeList<typename MetaFunction<Types>::type...>;
 };
 
 /**
@@ -195,4 +200,36 @@ struct _Variant<TypeList<Head, Tail...>> {
 template<typename List>
 using VariantOf = _Variant<List>::type;
 
+// Properties of all the types in a type list.
+
+template<typename List>
+struct _Properties;
+
+template<typename... Types>
+struct _Properties<TypeList<Types...>> {
+    static const constexpr bool trivially_copyable = (
+        std::is_trivially_copyable_v<Types> && ...
+    );
+    static const constexpr std::size_t max_size = std::max({sizeof(Types)...});
+    static const constexpr std::size_t max_align = std::max({alignof(Types)...});
+};
+
+/**
+ * @brief If every type in a type list is trivially copyable.
+ */
+template<typename List>
+inline constexpr bool TriviallyCopyable = _Properties<List>::trivially_copyable;
+
+/**
+ * @brief The size of the largest type in a type list.
+ */
+template<typename List>
+inline constexpr std::size_t MaxSize = _Properties<List>::max_size;
+
+/**
+ * @brief The largest alignment of the types in a type list.
+ */
+template<typename List>
+inline constexpr std::size_t MaxAlign = _Properties<List>::max_align;
+
 } // namespace TypeList
@@ -0,0 +1,161 @@
+#include "Test.h"
+
+#include <string>
+
+#include "util/Archetype.h"
+#include "util/CommandBuffer.h"
+#include "util/Component.h"
+
+/**
+ * @brief A component of a test entity.
+ */
+struct Position
+{
+    int x;
+    int y;
+};
+
+/**
+ * @brief A component of a test entity that owns memory.
+ */
+struct Name
+{
+    std::string name;
+};
+
+/**
+ * @brief Placeholders of created entities are replaced by the entities created
+ * when applied, in every later command of the buffer, and each placeholder
+ * resolves to its own entity.
+ */
+static void placeholders()
+{
+    EntityManager entities;
+    ComponentManager components;
+    components.register_component<Position>();
+    components.register_component<Name>();
+
+    // An existing entity whose index the placeholders must not be confused
+    // with, as the first placeholder also has index zero.
+    Entity existing = entities.create_entity();
+    components.add(existing, Position{-1, -1});
+    Signature position;
+    position.set(components.type<Position>());
+    entities.set_signature(existing, position);
+
+    CommandBuffer commands;
+    Entity first = commands.create_entity();
+    Entity second = commands.create_entity();
+    CHECK(first != second);
+    CHECK(!entities.alive(first));
+
+    commands.add(second, Name{"second"});
+    commands.add(first, Position{1, 2});
+    commands.add(first, Name{"first"});
+    commands.add(existing, Name{"existing"});
+    commands.apply(entities, components);
+
+    CHECK(entities.size() == 3);
+    CHECK(components.get<Position>(existing).x == -1);
+    CHECK(components.get<Name>(existing).name == "existing");
+
+    // Indices of a fresh entity manager are handed out in order.
+    Entity created_first = make_entity(1, 0);
+    Entity created_second = make_entity(2, 0);
+    CHECK(entities.alive(created_first));
+    CHECK(entities.alive(created_second));
+    CHECK(components.get<Position>(created_first).y == 2);
+    CHECK(components.get<Name>(created_first).name == "first");
+    CHECK(components.get<Name>(created_second).name == "second");
+
+    Signature both = position;
+    both.set(components.type<Name>());
+    CHECK(entities.get_signature(created_first) == both);
+    CHECK(entities.get_signature(existing) == both);
+
+    // Placeholders start again from zero after applying, resolving to the
+    // entities of the next apply.
+    Entity again = commands.create_entity();
+    CHECK(again == first);
+    commands.add(again, Name{"again"});
+    commands.apply(entities, components);
+
+    CHECK(entities.size() == 4);
+    CHECK(components.get<Name>(make_entity(3, 0)).name == "again");
+}
+
+/**
+ * @brief Components of commands cleared without being applied are destroyed,
+ * and nothing is applied.
+ */
+static void cleared()
+{
+    EntityManager entities;
+    ComponentManager components;
+    components.register_component<Name>();
+
+    CommandBuffer commands;
+    commands.add(commands.create_entity(), Name{std::string(1000, 'x')});
+    CHECK(!commands.empty());
+
+    commands.clear();
+    CHECK(commands.empty());
+
+    commands.apply(entities, components);
+    CHECK(entities.size() == 0);
+}
+
+/**
+ * @brief Commands applied to archetype storage create entities in it, move
+ * them between archetypes and keep the entity manager's signatures in step.
+ */
+static void archetypes()
+{
+    EntityManager entities;
+    ArchetypeStorage archetypes;
+    archetypes.register_component<Position>();
+    archetypes.register_component<Name>();
+
+    CommandBuffer commands;
+    Entity placeholder = commands.create_entity();
+    commands.add(placeholder, Position{1, 2});
+    commands.add(placeholder, Name{"rune"});
+    commands.apply(entities, archetypes);
+
+    CHECK(entities.size() == 1);
+
+    Entity entity = 0;
+    int found = 0;
+    archetypes.each<Position>([&](Entity each, Position &position) {
+        entity = each;
+        found += position.x;
+    });
+
+    CHECK(found == 1);
+    CHECK(entities.alive(entity));
+    CHECK(archetypes.stored(entity));
+    CHECK(archetypes.get<Position>(entity).y == 2);
+    CHECK(archetypes.get<Name>(entity).name == "rune");
+    CHECK(entities.get_signature(entity) == archetypes.get_signature(entity));
+
+    commands.remove<Position>(entity);
+    commands.apply(entities, archetypes);
+
+    CHECK(!archetypes.get_signature(entity).test(archetypes.type<Position>()));
+    CHECK(entities.get_signature(entity) == archetypes.get_signature(entity));
+    CHECK(archetypes.get<Name>(entity).name == "rune");
+
+    commands.destroy_entity(entity);
+    commands.apply(entities, archetypes);
+
+    CHECK(!archetypes.stored(entity));
+    CHECK(!entities.alive(entity));
+}
+
+int main()
+{
+    placeholders();
+    cleared();
+    archetypes();
+    return 0;
+}
@@ -0,0 +1,316 @@
+#include "Test.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "util/Component.h"
+#include "util/ThreadPool.h"
+#include "util/TypeList.h"
+
+/**
+ * @brief A component of a test entity.
+ */
+struct Position
+{
+    int x;
+    int y;
+};
+
+/**
+ * @brief Another component of a test entity.
+ */
+struct Velocity
+{
+    int dx;
+    int dy;
+};
+
+/**
+ * @brief A system counting the removals of positions since it last ran.
+ */
+class Removals : public System
+{
+public:
+
+    Removals(ComponentManager &components, Signature reads)
+        : System(reads, Signature())
+        , m_components(components)
+    {}
+
+    void update() override {
+        auto &positions = m_components.components<Position>();
+        positions.each_removed(m_since, [&](Entity) { ++seen; });
+        m_since = positions.tick();
+    }
+
+    /// The number of removals seen.
+    int seen = 0;
+
+private:
+
+    /// The components of the entities.
+    ComponentManager &m_components;
+
+    /// The tick the system last ran at.
+    std::uint64_t m_since = 0;
+};
+
+/**
+ * @brief Count the removals still logged.
+ */
+static int logged(ComponentManager &components)
+{
+    int count = 0;
+    components.components<Position>().each_removed(0, [&](Entity) { ++count; });
+    return count;
+}
+
+/**
+ * @brief Removals are logged until every system has run after them, then
+ * trimmed by the system manager, without any system missing one.
+ */
+static void trimmed()
+{
+    ThreadPool pool(2);
+    EntityManager entities;
+    ComponentManager components;
+    components.register_component<Position>();
+
+    Signature reads;
+    reads.set(components.type<Position>());
+
+    SystemManager systems(pool, &components);
+    auto first = systems.register_system<Removals>(components, reads);
+    auto second = systems.register_system<Removals>(components, reads);
+
+    std::vector<Entity> created;
+    for (int i = 0; i < 4; i++) {
+        created.push_back(entities.create_entity());
+        components.add(created.back(), Position{i, i});
+    }
+
+    components.remove<Position>(created[0]);
+    components.remove<Position>(created[1]);
+    CHECK(logged(components) == 2);
+
+    systems.update();
+    CHECK(first->seen == 2);
+    CHECK(second->seen == 2);
+    CHECK(logged(components) == 0);
+
+    components.remove<Position>(created[2]);
+    CHECK(logged(components) == 1);
+
+    systems.update();
+    CHECK(first->seen == 3);
+    CHECK(second->seen == 3);
+    CHECK(logged(components) == 0);
+}
+
+/**
+ * @brief Without a component manager, the system manager leaves the removal
+ * log to be trimmed by hand.
+ */
+static void untrimmed()
+{
+    ThreadPool pool(1);
+    EntityManager entities;
+    ComponentManager components;
+    components.register_component<Position>();
+
+    Signature reads;
+    reads.set(components.type<Position>());
+
+    SystemManager systems(pool);
+    systems.register_system<Removals>(components, reads);
+
+    Entity entity = entities.create_entity();
+    components.add(entity, Position{0, 0});
+    components.remove<Position>(entity);
+
+    systems.update();
+    CHECK(logged(components) == 1);
+
+    components.components<Position>().trim_removed(components.components<Position>().tick());
+    CHECK(logged(components) == 0);
+}
+
+/**
+ * @brief Helper jobs that start after a frame is done find nothing to run,
+ * so the system manager can be destroyed as soon as update() returns.
+ */
+static void destroyed()
+{
+    ThreadPool pool(4);
+    ComponentManager components;
+    components.register_component<Position>();
+
+    Signature reads;
+    reads.set(components.type<Position>());
+
+    for (int i = 0; i < 100; i++) {
+        SystemManager systems(pool);
+        std::vector<std::shared_ptr<Removals>> registered;
+        for (int j = 0; j < 4; j++)
+            registered.push_back(systems.register_system<Removals>(components, reads));
+
+        systems.update();
+        for (auto &system : registered)
+            CHECK(system->seen == 0);
+    }
+}
+
+/**
+ * @brief Removing a component moves the last into its place, keeping the
+ * components packed and every other entity's component reachable.
+ */
+static void sparse_set()
+{
+    EntityManager entities;
+    ComponentArray<Position> positions;
+
+    std::vector<Entity> created;
+    for (int i = 0; i < 5; i++) {
+        created.push_back(entities.create_entity());
+        positions.add(created.back(), Position{i, -i});
+    }
+
+    std::uint64_t before = positions.tick();
+    positions.modify(created[4]).x = 40;
+
+    positions.remove(created[1]);
+    CHECK(positions.size() == 4);
+    CHECK(!positions.has(created[1]));
+
+    // The last component moved into the removed one's place, keeping the tick
+    // it last changed on.
+    CHECK(positions.entities()[1] == created[4]);
+    CHECK(positions.components()[1].x == 40);
+    CHECK(positions.changed(created[4], before));
+    CHECK(!positions.changed(created[0], before));
+
+    for (int i : {0, 2, 3}) {
+        CHECK(positions.has(created[i]));
+        CHECK(positions.get(created[i]).x == i);
+        CHECK(positions.get(created[i]).y == -i);
+    }
+
+    // Removing the last component moves nothing.
+    positions.remove(created[3]);
+    CHECK(positions.size() == 3);
+    CHECK(positions.entities()[1] == created[4]);
+    CHECK(positions.entities()[2] == created[2]);
+
+    // Entities beyond the first page of the sparse array.
+    Entity far = make_entity(5000, 0);
+    positions.add(far, Position{5, 5});
+    CHECK(positions.has(far));
+    CHECK(!positions.has(make_entity(5001, 0)));
+    CHECK(!positions.has(make_entity(100000, 0)));
+    CHECK(positions.get(far).x == 5);
+}
+
+/**
+ * @brief An identifier kept after its entity is destroyed is stale, even
+ * once its index is reused.
+ */
+static void stale_handles()
+{
+    EntityManager entities;
+    ComponentArray<Position> positions;
+
+    Entity first = entities.create_entity();
+    positions.add(first, Position{1, 1});
+    CHECK(entities.alive(first));
+
+    positions.entity_destroyed(first);
+    entities.destroy_entity(first);
+    CHECK(!entities.alive(first));
+    CHECK(entities.size() == 0);
+
+    Entity second = entities.create_entity();
+    CHECK(entity_index(second) == entity_index(first));
+    CHECK(entity_generation(second) == entity_generation(first) + 1);
+    CHECK(second != first);
+    CHECK(entities.alive(second));
+    CHECK(!entities.alive(first));
+
+    // The stale identifier does not see the new entity's component.
+    positions.add(second, Position{2, 2});
+    CHECK(positions.has(second));
+    CHECK(!positions.has(first));
+
+    // Signatures are reset when the index is reused.
+    Signature signature;
+    signature.set(3);
+    entities.set_signature(second, signature);
+    CHECK(entities.get_signature(second) == signature);
+
+    entities.destroy_entity(second);
+    Entity third = entities.create_entity();
+    CHECK(entities.get_signature(third).none());
+    CHECK(!entities.alive(second));
+}
+
+/**
+ * @brief A static component manager stores each component type known at
+ * compile time in its own array.
+ */
+static void static_manager()
+{
+    using Components = TypeList::TypeList<Position, Velocity>;
+    using Manager = StaticComponentManager<Components>;
+
+    static_assert(Manager::type<Position>() == 0);
+    static_assert(Manager::type<Velocity>() == 1);
+    static_assert(Manager::size() == 2);
+
+    Signature both = Manager::signature<Position, Velocity>();
+    CHECK(both.test(0) && both.test(1) && both.count() == 2);
+    CHECK(Manager::signature<Velocity>().count() == 1);
+    CHECK(Manager::signature<Velocity>().test(1));
+
+    EntityManager entities;
+    Manager components;
+
+    Entity a = entities.create_entity();
+    Entity b = entities.create_entity();
+    components.add(a, Position{1, 2});
+    components.add(a, Velocity{3, 4});
+    components.add(b, Position{5, 6});
+
+    CHECK(components.has<Position>(a));
+    CHECK(components.has<Velocity>(a));
+    CHECK(components.has<Position>(b));
+    CHECK(!components.has<Velocity>(b));
+    CHECK(components.get<Position>(a).y == 2);
+    CHECK(components.get<Velocity>(a).dx == 3);
+
+    std::uint64_t before = components.components<Position>().tick();
+    components.modify<Position>(b).x = 50;
+    CHECK(components.get<Position>(b).x == 50);
+    CHECK(components.components<Position>().changed(b, before));
+    CHECK(!components.components<Position>().changed(a, before));
+
+    components.remove<Velocity>(a);
+    CHECK(!components.has<Velocity>(a));
+    CHECK(components.has<Position>(a));
+
+    components.entity_destroyed(b);
+    CHECK(!components.has<Position>(b));
+    CHECK(components.has<Position>(a));
+    CHECK(components.components<Position>().size() == 1);
+    CHECK(components.components<Velocity>().size() == 0);
+}
+
+int main()
+{
+    trimmed();
+    untrimmed();
+    destroyed();
+    sparse_set();
+    stale_handles();
+    static_manager();
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "Test.h"
+
+#include <cmath>
+#include <random>
+#include <set>
+#include <utility>
+
+#include "util/Hexagon.h"
+
+/**
+ * @brief The range of a rectangle contains every hexagon whose centre is
+ * within a hexagon's size of it, each once, and no hexagon further away.
+ */
+template<Hexagon::GridType Type>
+static void range()
+{
+    const double SIZE = 20.0;
+    Hexagon::Grid<Type> grid(SIZE, SIZE, 400.0, 300.0);
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> coordinate(-500.0, 1500.0);
+
+    for (int i = 0; i < 50; i++) {
+        double left = coordinate(random);
+        double top = coordinate(random);
+        double right = left + std::abs(coordinate(random)) / 3;
+        double bottom = top + std::abs(coordinate(random)) / 3;
+
+        auto hexagons = grid.range(left, top, right, bottom);
+
+        std::set<std::pair<int, int>> found;
+        for (const auto &hexagon : hexagons)
+            found.insert({hexagon.q, hexagon.r});
+        CHECK(found.size() == hexagons.size());
+
+        for (int q = -100; q <= 100; q++) {
+            for (int r = -100; r <= 100; r++) {
+                auto [x, y] = grid.to_pixel(Hexagon::Hexagon<int>(q, r));
+
+                bool inside = (
+                    x >= left - SIZE && x <= right + SIZE &&
+                    y >= top - SIZE && y <= bottom + SIZE
+                );
+                bool near = (
+                    x >= left - 2 * SIZE - 0.01 && x <= right + 2 * SIZE + 0.01 &&
+                    y >= top - 2 * SIZE - 0.01 && y <= bottom + 2 * SIZE + 0.01
+                );
+                bool included = found.contains({q, r});
+
+                if (inside)
+                    CHECK(included);
+                if (included)
+                    CHECK(near);
+            }
+        }
+    }
+}
+
+int main()
+{
+    range<Hexagon::GridType::FLAT>();
+    range<Hexagon::GridType::POINTY>();
+    return 0;
+}
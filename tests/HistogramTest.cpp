@@ -0,0 +1,99 @@
+#include "Test.h"
+
+#include <cstdint>
+
+#include "util/Histogram.h"
+
+/**
+ * @brief Values below the linear buckets are counted exactly.
+ */
+static void linear_buckets()
+{
+    for (std::uint64_t value = 0; value < Histogram::LINEAR_BUCKETS; value++) {
+        CHECK(Histogram::bucket(value) == value);
+        CHECK(Histogram::highest(value) == value);
+    }
+}
+
+/**
+ * @brief Every value is in a bucket whose range contains it, buckets are in
+ * order, and each bucket is within the relative error of its values.
+ */
+static void bucket_ranges()
+{
+    std::uint64_t lowest = 0;
+
+    for (std::size_t bucket = 0; bucket < Histogram::BUCKETS; bucket++) {
+        std::uint64_t highest = Histogram::highest(bucket);
+        CHECK(highest >= lowest);
+        CHECK(Histogram::bucket(lowest) == bucket);
+        CHECK(Histogram::bucket(highest) == bucket);
+        CHECK(highest - lowest <= lowest / Histogram::SUB_BUCKETS);
+
+        if (highest == UINT64_MAX) {
+            CHECK(bucket == Histogram::BUCKETS - 1);
+            break;
+        }
+
+        lowest = highest + 1;
+    }
+
+    CHECK(Histogram::highest(Histogram::BUCKETS - 1) == UINT64_MAX);
+}
+
+/**
+ * @brief Percentiles and statistics of recorded values.
+ */
+static void percentiles()
+{
+    Histogram histogram;
+    for (std::uint64_t value = 1; value <= 100; value++)
+        histogram.record(value);
+
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    CHECK(snapshot.count() == 100);
+    CHECK(snapshot.min() == 1);
+    CHECK(snapshot.max() == 100);
+    CHECK(snapshot.mean() == 50.5);
+
+    // Reported values are the top of their bucket, within the relative error.
+    std::uint64_t median = snapshot.percentile(50);
+    CHECK(median >= 50 && median <= 50 + 50 / Histogram::SUB_BUCKETS);
+    CHECK(snapshot.percentile(100) == 100);
+    CHECK(snapshot.percentile(0) == 1);
+
+    Histogram empty;
+    CHECK(empty.snapshot().percentile(50) == 0);
+    CHECK(empty.snapshot().min() == 0);
+}
+
+/**
+ * @brief Merging snapshots combines their counts.
+ */
+static void merge()
+{
+    Histogram a;
+    Histogram b;
+    a.record(10, 3);
+    b.record(1000);
+
+    Histogram::Snapshot snapshot = a.snapshot();
+    snapshot.merge(b.snapshot());
+
+    CHECK(snapshot.count() == 4);
+    CHECK(snapshot.min() == 10);
+    CHECK(snapshot.max() == 1000);
+    CHECK(snapshot.percentile(75) == 10);
+    CHECK(snapshot.percentile(100) == 1000);
+
+    a.reset();
+    CHECK(a.snapshot().count() == 0);
+}
+
+int main()
+{
+    linear_buckets();
+    bucket_ranges();
+    percentiles();
+    merge();
+}
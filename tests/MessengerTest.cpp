@@ -0,0 +1,202 @@
+#include "Test.h"
+
+#include <atomic>
+#include <stop_token>
+#include <thread>
+
+#include "util/Messenger.h"
+#include "util/ThreadPool.h"
+#include "util/TypeList.h"
+
+/**
+ * @brief A message of a test topic.
+ */
+struct Value
+{
+    int value;
+};
+
+using Topics = TypeList::TypeList<Value>;
+
+/**
+ * @brief Messages published to a running messenger reach its subscribers.
+ */
+static void delivery()
+{
+    ThreadPool pool(2);
+    std::atomic<int> total {0};
+
+    {
+        Messenger<Topics> messenger(std::nullopt, pool);
+        messenger.subscribe<0>([&](const Value &message) {
+            total += message.value;
+            total.notify_all();
+        });
+
+        for (int i = 1; i <= 10; i++)
+            messenger.publish<0>(i);
+
+        for (int seen = total.load(); seen != 55; seen = total.load())
+            total.wait(seen);
+    }
+
+    CHECK(total == 55);
+}
+
+/**
+ * @brief Waiting for the messenger to be idle returns once every published
+ * message has been dispatched, as when a headless replay ends.
+ */
+static void idle()
+{
+    ThreadPool pool(4);
+    Messenger<Topics> messenger(std::nullopt, pool);
+    std::atomic<int> total {0};
+
+    messenger.subscribe<0>([&](const Value &message) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        total += message.value;
+    });
+
+    for (int i = 1; i <= 100; i++)
+        messenger.publish<0>(i);
+
+    messenger.wait_idle();
+    CHECK(total == 5050);
+    CHECK(messenger.statistics()[0].dispatched == 100);
+    CHECK(messenger.statistics()[0].queue_depth == 0);
+}
+
+/**
+ * @brief Once unsubscribe returns the subscriber is no longer called back,
+ * while other subscribers still are.
+ */
+static void unsubscribed()
+{
+    ThreadPool pool(2);
+    Messenger<Topics> messenger(std::nullopt, pool);
+    std::atomic<int> removed {0};
+    std::atomic<int> kept {0};
+
+    std::size_t id = messenger.subscribe<0>([&](const Value &) { ++removed; });
+    messenger.subscribe<0>([&](const Value &) {
+        ++kept;
+        kept.notify_all();
+    });
+
+    messenger.publish<0>(1);
+    messenger.unsubscribe<0>(id);
+    int before = removed.load();
+
+    messenger.publish<0>(2);
+    for (int seen = kept.load(); seen != 2; seen = kept.load())
+        kept.wait(seen);
+
+    CHECK(removed == before);
+}
+
+/**
+ * @brief A messenger destroyed while its jobs are still queued behind a busy
+ * pool returns once they run, and the jobs do not call back afterwards.
+ */
+static void destroyed_with_queued_jobs()
+{
+    ThreadPool pool(1);
+    std::stop_source stop;
+    std::atomic<bool> busy {false};
+    std::atomic<bool> release {false};
+    std::atomic<int> calls {0};
+
+    // Keep the only worker busy so that the messenger's jobs stay queued.
+    pool.submit([&](std::stop_token) {
+        busy = true;
+        busy.notify_all();
+        release.wait(false);
+    });
+    busy.wait(false);
+
+    std::jthread destroyer;
+    {
+        auto messenger = std::make_unique<Messenger<Topics>>(stop, pool);
+        messenger->subscribe<0>([&](const Value &) { ++calls; });
+
+        for (int i = 0; i < 10; i++)
+            messenger->publish<0>(i);
+
+        destroyer = std::jthread([messenger = std::move(messenger)]() mutable {
+            messenger.reset();
+        });
+    }
+
+    // Only release the worker once the destructor has begun.
+    while (!stop.stop_requested())
+        std::this_thread::yield();
+
+    release = true;
+    release.notify_all();
+    destroyer.join();
+
+    CHECK(calls == 0);
+}
+
+/**
+ * @brief Jobs submitted to a stopped pool are cancelled rather than left
+ * queued, so a messenger on it can still be destroyed.
+ */
+static void stopped_pool()
+{
+    std::stop_source stop;
+    ThreadPool pool(1, false, stop);
+    stop.request_stop();
+
+    std::atomic<bool> cancelled {false};
+    pool.submit([&](std::stop_token token) {
+        cancelled = token.stop_requested();
+    });
+    CHECK(cancelled);
+
+    std::atomic<int> calls {0};
+    {
+        Messenger<Topics> messenger(std::nullopt, pool);
+        messenger.subscribe<0>([&](const Value &) { ++calls; });
+        messenger.publish<0>(1);
+    }
+
+    CHECK(calls == 0);
+}
+
+/**
+ * @brief Jobs still queued when a pool is destroyed are cancelled.
+ */
+static void destroyed_pool()
+{
+    std::atomic<int> cancelled {0};
+
+    {
+        ThreadPool pool(1);
+        pool.submit([](std::stop_token stop) {
+            while (!stop.stop_requested())
+                std::this_thread::yield();
+        });
+
+        for (int i = 0; i < 10; i++) {
+            pool.submit([&](std::stop_token stop) {
+                if (stop.stop_requested())
+                    ++cancelled;
+            });
+        }
+    }
+
+    CHECK(cancelled == 10);
+}
+
+int main()
+{
+    delivery();
+    idle();
+    unsubscribed();
+    destroyed_with_queued_jobs();
+    stopped_pool();
+    destroyed_pool();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "Test.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+#include "util/QualityController.h"
+
+/// The time available for each frame.
+static const Time::Duration BUDGET = 10ms;
+
+/**
+ * @brief Record frames whose cost depends on the current level, counting the
+ * changes of level.
+ *
+ * @param quality The controller to record frames to.
+ * @param frames The number of frames to record.
+ * @param load The fraction of the budget a frame takes at a level.
+ * @return The number of times the level changed.
+ */
+static std::size_t run(
+    QualityController &quality,
+    std::size_t frames,
+    const std::function<double(const QualityController::Level&)> &load
+) {
+    std::size_t changes = 0;
+    for (std::size_t i = 0; i < frames; i++) {
+        auto cost = std::chrono::duration_cast<Time::Duration>(
+            BUDGET * load(quality.level())
+        );
+        changes += quality.record(cost, BUDGET);
+    }
+
+    return changes;
+}
+
+/**
+ * @brief Frames taking most of their budget step the quality down a level at
+ * a time, stopping at the cheapest.
+ */
+static void step_down()
+{
+    QualityController quality({{1.0f, 4}, {1.0f, 0}, {0.5f, 0}});
+
+    CHECK(run(quality, 1, [](auto&) { return 0.95; }) == 0);
+    CHECK(quality.level().antialiasing == 4);
+
+    CHECK(run(quality, 7, [](auto&) { return 0.95; }) == 1);
+    CHECK(quality.level().antialiasing == 0);
+    CHECK(quality.level().scale == 1.0f);
+
+    CHECK(run(quality, 8, [](auto&) { return 0.95; }) == 1);
+    CHECK(quality.level().scale == 0.5f);
+
+    CHECK(run(quality, 100, [](auto&) { return 0.95; }) == 0);
+    CHECK(quality.level().scale == 0.5f);
+}
+
+/**
+ * @brief Frames taking little of their budget step the quality back up, only
+ * after many frames, and not when the level above would be slow.
+ */
+static void step_up()
+{
+    QualityController quality({{1.0f, 0}, {0.5f, 0}});
+    auto pixels = [](const QualityController::Level &level) {
+        return 0.3 * level.scale * level.scale;
+    };
+
+    CHECK(run(quality, 20, [](auto&) { return 0.95; }) == 1);
+    CHECK(quality.level().scale == 0.5f);
+
+    CHECK(run(quality, 100, pixels) == 0);
+    CHECK(quality.level().scale == 0.5f);
+
+    CHECK(run(quality, 1000, pixels) == 1);
+    CHECK(quality.level().scale == 1.0f);
+
+    // The full level would take 0.9 of the budget, above the 0.8 counted as
+    // slow, so the quality is not raised to it.
+    QualityController slow({{1.0f, 0}, {0.5f, 0}});
+    CHECK(run(slow, 20, [](auto&) { return 0.95; }) == 1);
+    CHECK(run(slow, 5000, [](auto &level) {
+        return 0.9 * level.scale * level.scale;
+    }) == 0);
+    CHECK(slow.level().scale == 0.5f);
+}
+
+/**
+ * @brief A level too slow only by a little is not returned to over and over,
+ * whether its cost is predicted from its pixels or not.
+ */
+static void no_oscillation()
+{
+    // Cost in proportion to pixels, with 0.75 scale taking 85% of the budget.
+    QualityController scaled({{1.0f, 0}, {0.75f, 0}, {0.5f, 0}});
+    auto pixels = [](const QualityController::Level &level) {
+        return 0.85 * level.scale * level.scale / (0.75 * 0.75);
+    };
+
+    CHECK(run(scaled, 2000, pixels) == 2);
+    CHECK(scaled.level().scale == 0.5f);
+
+    // Antialiasing costing more than its pixels suggest, so returning to it
+    // is only held back by backing off.
+    QualityController antialiased({{1.0f, 4}, {1.0f, 0}});
+    auto samples = [](const QualityController::Level &level) {
+        return level.antialiasing ? 0.85 : 0.35;
+    };
+
+    CHECK(run(antialiased, 2000, samples) <= 8);
+}
+
+int main()
+{
+    step_down();
+    step_up();
+    no_oscillation();
+    return 0;
+}
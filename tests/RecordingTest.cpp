@@ -0,0 +1,108 @@
+#include "Test.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "util/Messenger.h"
+#include "util/Recording.h"
+#include "util/ThreadPool.h"
+#include "util/TypeList.h"
+
+/**
+ * @brief A message of a test topic.
+ */
+struct Value
+{
+    int value;
+};
+
+using Topics = TypeList::TypeList<Value>;
+
+/**
+ * @brief Get a path for a temporary recording.
+ */
+static std::string temporary(const char *name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+/**
+ * @brief Recorded messages are replayed in order, with their batches.
+ */
+static void round_trip()
+{
+    std::string path = temporary("runes_round_trip.rec");
+    ThreadPool pool(2);
+
+    {
+        Messenger<Topics> messenger(std::nullopt, pool);
+        Recording::Recorder<Topics> recorder(messenger, path);
+
+        messenger.publish<0>(1);
+        messenger.publish_batch<0>(std::vector<Value>{{2}, {3}});
+    }
+
+    Recording::Replayer<Topics> replayer(path);
+    CHECK(replayer.size() == 2);
+
+    std::atomic<int> total {0};
+    std::atomic<int> received {0};
+    {
+        Messenger<Topics> messenger(std::nullopt, pool);
+        messenger.subscribe<0>([&](const Value &message) {
+            total += message.value;
+            ++received;
+            received.notify_all();
+        });
+
+        replayer.replay(
+            messenger,
+            Recording::Replayer<Topics>::Speed::MAXIMUM
+        );
+
+        for (int seen = received.load(); seen != 3; seen = received.load())
+            received.wait(seen);
+    }
+
+    CHECK(total == 6);
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Loading a truncated recording reports an error.
+ */
+static void truncated()
+{
+    std::string path = temporary("runes_truncated.rec");
+    ThreadPool pool(1);
+
+    {
+        Messenger<Topics> messenger(std::nullopt, pool);
+        Recording::Recorder<Topics> recorder(messenger, path);
+        messenger.publish<0>(1);
+    }
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+    bool thrown = false;
+    try {
+        Recording::Replayer<Topics> replayer(path);
+    }
+    catch (const std::runtime_error &) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+    std::remove(path.c_str());
+}
+
+int main()
+{
+    round_trip();
+    truncated();
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "Test.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "util/SharedMessenger.h"
+#include "util/TypeList.h"
+
+/**
+ * @brief A message of a test topic.
+ */
+struct Value
+{
+    int value;
+};
+
+/**
+ * @brief A message of another test topic.
+ */
+struct Pair
+{
+    int first;
+    int second;
+};
+
+using Topics = TypeList::TypeList<Value, Pair>;
+
+/**
+ * @brief Get a shared memory name unique to this process.
+ */
+static std::string name(const char *test)
+{
+    return "/runes_" + std::string(test) + "_" + std::to_string(getpid());
+}
+
+/**
+ * @brief Messages published by an opener reach the creator's subscribers, in
+ * order, including after the reader has gone to sleep.
+ */
+static void delivery()
+{
+    SharedMessenger<Topics> server(name("delivery"), true);
+    SharedMessenger<Topics> client(name("delivery"), false);
+
+    std::atomic<int> total {0};
+    std::atomic<int> received {0};
+    server.subscribe<0>([&](const Value &message) {
+        total += message.value;
+        ++received;
+        received.notify_all();
+    });
+    server.subscribe<1>([&](const Pair &message) {
+        total += message.first * message.second;
+        ++received;
+        received.notify_all();
+    });
+
+    client.publish<0>(1);
+    client.publish<1>(2, 3);
+
+    for (int seen = received.load(); seen != 2; seen = received.load())
+        received.wait(seen);
+
+    // Long enough for the reader to be sleeping on the futex.
+    std::this_thread::sleep_for(100ms);
+
+    Value value {4};
+    client.publish(0, &value);
+
+    for (int seen = received.load(); seen != 3; seen = received.load())
+        received.wait(seen);
+
+    CHECK(total == 11);
+    CHECK(client.statistics()[0].published == 2);
+    CHECK(client.statistics()[1].published == 1);
+    CHECK(server.statistics()[0].dispatched == 2);
+    CHECK(server.statistics()[1].dispatched == 1);
+}
+
+/**
+ * @brief Callbacks may subscribe and unsubscribe, and unsubscribed callbacks
+ * are no longer called back.
+ */
+static void subscriptions()
+{
+    SharedMessenger<Topics> server(name("subscriptions"), true);
+
+    std::atomic<int> first {0};
+    std::atomic<int> second {0};
+    std::atomic<int> received {0};
+    std::size_t id = 0;
+
+    // Subscribing from the reader would deadlock if it held its lock while
+    // calling back.
+    server.subscribe<0>([&](const Value &message) {
+        if (message.value == 1) {
+            id = server.subscribe<1>([&](const Pair &) { ++second; });
+        }
+        ++first;
+        ++received;
+        received.notify_all();
+    });
+
+    server.publish<0>(1);
+    for (int seen = received.load(); seen != 1; seen = received.load())
+        received.wait(seen);
+
+    server.publish<1>(2, 3);
+    server.publish<0>(2);
+    for (int seen = received.load(); seen != 2; seen = received.load())
+        received.wait(seen);
+
+    CHECK(second == 1);
+
+    server.unsubscribe<1>(id);
+    server.publish<1>(4, 5);
+    server.publish<0>(3);
+    for (int seen = received.load(); seen != 3; seen = received.load())
+        received.wait(seen);
+
+    CHECK(first == 3);
+    CHECK(second == 1);
+}
+
+/**
+ * @brief Publishing to a full ring drops the message after a while instead of
+ * waiting forever, or at once when trying, and counts it as dropped.
+ */
+static void full()
+{
+    SharedMessenger<Topics> server(name("full"), true, std::nullopt, 2);
+
+    server.publish<0>(1);
+    server.publish<0>(2);
+    server.publish<0>(3);
+    CHECK(server.statistics()[0].published == 2);
+    CHECK(server.statistics()[0].dropped == 1);
+
+    Value value {4};
+    CHECK(!server.try_publish(0, &value));
+    CHECK(server.statistics()[0].dropped == 2);
+}
+
+/**
+ * @brief Opening a shared messenger that does not exist fails.
+ */
+static void missing()
+{
+    bool thrown = false;
+    try {
+        SharedMessenger<Topics> client(name("missing"), false);
+    }
+    catch (const std::runtime_error &) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+}
+
+int main()
+{
+    delivery();
+    subscriptions();
+    full();
+    missing();
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * @brief Check a condition holds, exiting the test with an error if not.
+ *
+ * Unlike assert, checks are made in every build type.
+ */
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__                          \
+                << ": check failed: " #condition "\n";                        \
+            std::exit(EXIT_FAILURE);                                          \
+        }                                                                     \
+    } while (false)
@@ -0,0 +1,123 @@
+#include "Test.h"
+
+#include <atomic>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "util/TimerWheel.h"
+#include "util/Time.h"
+
+/**
+ * @brief A one shot timer runs once, and not before it is due.
+ */
+static void one_shot()
+{
+    TimerWheel timers;
+    std::atomic<int> runs {0};
+    std::atomic<bool> early {false};
+
+    Time::Timestamp due = Time::now() + 20ms;
+    timers.at(due, [&]{
+        early = Time::now() < due;
+        ++runs;
+        runs.notify_all();
+    });
+
+    runs.wait(0);
+    std::this_thread::sleep_for(20ms);
+
+    CHECK(runs == 1);
+    CHECK(!early);
+    CHECK(timers.size() == 0);
+}
+
+/**
+ * @brief A fixed rate timer keeps running until cancelled, and not after.
+ */
+static void fixed_rate()
+{
+    TimerWheel timers;
+    std::stop_source cancel;
+    std::atomic<int> runs {0};
+
+    timers.every(2ms, [&]{
+        ++runs;
+        runs.notify_all();
+    }, cancel.get_token());
+
+    for (int seen = runs.load(); seen < 5; seen = runs.load())
+        runs.wait(seen);
+
+    cancel.request_stop();
+    std::this_thread::sleep_for(10ms);
+    int after = runs.load();
+    std::this_thread::sleep_for(20ms);
+
+    CHECK(runs == after);
+}
+
+/**
+ * @brief Timers due over a range of wheels run in order of when they are due.
+ */
+static void order()
+{
+    TimerWheel timers(std::nullopt, 100us);
+    std::mutex mutex;
+    std::vector<int> ran;
+    std::atomic<int> runs {0};
+
+    Time::Timestamp start = Time::now();
+    for (int i : {7, 1, 30, 12, 3, 90}) {
+        timers.at(start + i * 1ms, [&, i]{
+            {
+                std::scoped_lock lock(mutex);
+                ran.push_back(i);
+            }
+            ++runs;
+            runs.notify_all();
+        });
+    }
+
+    for (int seen = runs.load(); seen < 6; seen = runs.load())
+        runs.wait(seen);
+
+    std::scoped_lock lock(mutex);
+    CHECK((ran == std::vector<int>{1, 3, 7, 12, 30, 90}));
+}
+
+/**
+ * @brief Cancelled timers do not run, and are removed once their slot is
+ * next added to rather than held until due.
+ */
+static void cancelled()
+{
+    TimerWheel timers;
+    std::atomic<int> runs {0};
+    Time::Timestamp due = Time::now() + 10s;
+
+    for (int i = 0; i < 100; i++) {
+        std::stop_source cancel;
+        timers.at(due, [&]{ ++runs; }, cancel.get_token());
+        cancel.request_stop();
+    }
+
+    CHECK(timers.size() == 1);
+
+    std::stop_source cancel;
+    timers.after(5ms, [&]{ ++runs; }, cancel.get_token());
+    cancel.request_stop();
+    std::this_thread::sleep_for(20ms);
+
+    CHECK(runs == 0);
+}
+
+int main()
+{
+    one_shot();
+    fixed_rate();
+    order();
+    cancelled();
+    return 0;
+}